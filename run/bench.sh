@@ -0,0 +1,36 @@
+#!/bin/bash
+
+# Benchmark suite, CSV on stdout: backend,test,config,iterations,value,unit
+#   match_throughput  matches/s of probSemSharedMemSoccerGame (and of the thread engine) in batch mode
+#   ping_pong ...     semUp/semDown latencies of the SysV and futex semaphores (semBench_*)
+#   saveState         cost of a saveState call per logging mode, format and number of entities (logBench)
+#
+# usage: bench.sh [runs] [iterations]
+
+runs=${1:-50}
+iter=${2:-100000}
+
+echo "backend,test,config,iterations,value,unit"
+
+# entity counts: players goalies referees matches (1 match is a normal game, more is a tournament)
+for cfg in "10 3 1 1" "20 6 2 4" "40 12 4 10" "100 30 8 25"
+do
+   set -- $cfg
+   opts="-p $1 -g $2"
+   [ $4 -gt 1 ] && opts="$opts -r $3 -m $4"
+   for game in probSemSharedMemSoccerGame probThreadSoccerGame
+   do
+      [ -x ./$game ] || continue
+      ./$game $opts -n $runs /dev/null 2>&1 >/dev/null | \
+         awk -v cfg="players=$1;goalies=$2;referees=$3;matches=$4" -v runs=$runs \
+             '/matches\/s/ { printf("%s,match_throughput,%s,%d,%s,matches/s\n", $6, cfg, runs, $(NF-1)) }'
+   done
+done
+
+for sem in semBench_sysv semBench_futex
+do
+   [ -x ./$sem ] && ./$sem $iter
+done
+
+[ -x ./logBench ] && ./logBench $iter 2>/dev/null
+rm -f error_*
@@ -3,15 +3,24 @@
 rm -f error*
 rm -f core
 
-#unsafe
-key=$(ipcs | grep " 120 " | cut -d\  -f1)
+# IPC keys are ftok(".", 'a') (the futex semaphores are in its shared memory block) and ftok(".", 'h') for the semaphore
+# statistics (make stats); each game process takes the first free key of the 64 from there up (KEY_RANGE).
+# The program reclaims the keys left by a crashed run by itself, this is only needed to remove them by hand
+dev=$(( $(stat -c %d .) & 0xff ))
+ino=$(( $(stat -c %i .) & 0xffff ))
 
-if [[ -z $key ]]
+found=0
+for k in $(seq 0 ${1:-63})
+do
+   key=$(printf "0x61%02x%04x" $dev $(( (ino + k) & 0xffff )))
+   hkey=$(printf "0x68%02x%04x" $dev $(( (ino + k) & 0xffff )))
+   ipcrm -S $key 2>/dev/null && found=1
+   ipcrm -M $key 2>/dev/null && found=1
+   ipcrm -M $hkey 2>/dev/null && found=1
+done
+
+if [[ $found -eq 0 ]]
 then
    echo Did not find soccergame IPC resources
    exit 1
 fi
-
-ipcrm -S $key
-ipcrm -M $key
-
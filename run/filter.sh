@@ -1,4 +1,4 @@
 #!/bin/bash
 
-./probSemSharedMemSoccerGame | awk -f filter_log.awk
+./probSemSharedMemSoccerGame -f delta "$@" | ./logDecode -d
 
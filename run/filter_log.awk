@@ -1,23 +1,22 @@
 BEGIN {
      FS = " ";
-     f=1
-     #players
-     for(i=0;i<10;i++) {
-        FieldSize[f++] = 4;
-     }
-     #goalies
-     FieldSize[f++]=5;
-     for(i=0;i<2;i++) {
-        FieldSize[f++] = 4;
+     nCols = 0
+}
+
+# header line: one column per player (Pnn), goalie (Gnn) and referee (Rnn)
+/^ *P[0-9]+ / && nCols == 0 {
+     nCols = NF
+     for(i=1;i<=NF;i++) {
+        FieldSize[i] = 4;
+        # first goalie and referee columns are preceded by an extra separator
+        if(i>1 && substr($i,1,1) != substr($(i-1),1,1)) FieldSize[i] = 5;
      }
-     #referee
-     FieldSize[f++]=5;
 }
 
 /.*/ {
-    if(NF==14) {
+    if(nCols > 0 && NF==nCols) {
 #        print  "NOTFILTE " $0
-        for(i=1; i<=14; i++) {
+        for(i=1; i<=nCols; i++) {
                if($i==prev[i]) {
                  printf("%*s ",FieldSize[i],".")
                }
@@ -0,0 +1,66 @@
+#!/bin/bash
+
+# Stress harness, CSV on stdout: engine,config,runs,matches_per_s,rss_main_kB,rss_entity_kB,check
+#   every configuration is played without delays in batch mode by probSemSharedMemSoccerGame (zygote spawn mode)
+#   and by probThreadSoccerGame; the delta log of the last game is checked by logDecode -c (state table
+#   transitions, team composition, late entities only after the cutoff), whose report of a failed check is
+#   kept in stress_<engine>_<config>.err. The games are played in the scratch directory stress_<pid>, so their log
+#   and error_* files never touch the ones of run/; the error files of a failed game are kept as
+#   stress_<engine>_<config>.error_*. The exit status is the number of failed configurations.
+#
+# usage: stress.sh [runs] [max entities]
+
+runs=${1:-3}
+max=${2:-13100}
+failed=0
+work=stress_$$
+mkdir -p $work || exit 1
+
+echo "engine,config,runs,matches_per_s,rss_main_kB,rss_entity_kB,check"
+
+# players goalies team_players team_goalies referees matches (1 match is a normal game, more is a tournament);
+#   with a single referee the matches do not overlap in the log and the teams of each one are checked on their
+#   own, while many teams are formed at the same time (200 60 4 1 1 200: the pairing of the teams by the referee)
+for cfg in "10 3 4 1 1 1" "12 4 3 2 1 1" "20 6 4 1 1 10" "40 12 4 1 4 20" "100 30 5 2 8 50" "200 60 4 1 1 200" \
+           "1000 300 4 1 16 100" "3000 1000 8 2 32 200" "10000 3000 4 1 64 100"
+do
+   set -- $cfg
+   [ $(($1 + $2 + $5)) -gt $max ] && continue
+   opts="-p $1 -g $2 -P $3 -G $4"
+   check="-P $3 -G $4"
+   if [ $6 -gt 1 ]; then
+      opts="$opts -r $5 -m $6"
+      check="$check -m $6"
+   fi
+   name="$1_$2_$3_$4_$5_$6"
+   for game in probSemSharedMemSoccerGame probThreadSoccerGame
+   do
+      [ -x ./$game ] || continue
+      spawn=""
+      [ $game = probSemSharedMemSoccerGame ] && spawn="-s zygote"
+      rm -f $work/error_*
+      out=$(cd $work && ../$game $opts $spawn -d 0 -f delta -n $runs stress.log 2>&1 >/dev/null)
+      status=$?
+      rate=$(echo "$out" | awk '/matches\/s/ { print $(NF-1) }')
+      rss=$(echo "$out" | awk '/peak rss/ { print $4 "," $8 }')
+      result=ok
+      if [ $status -ne 0 ]; then
+         result=game_failed
+         echo "$out" > stress_${game}_$name.err
+      elif ! ./logDecode -c $check $work/stress.log >/dev/null 2>stress_${game}_$name.err; then
+         result=check_failed
+      else
+         rm -f stress_${game}_$name.err
+      fi
+      if [ $result != ok ]; then
+         failed=$((failed + 1))
+         for f in $work/error_*; do
+            [ -f "$f" ] && mv "$f" stress_${game}_$name.${f#$work/}
+         done
+      fi
+      echo "$game,players=$1;goalies=$2;team=$3+$4;referees=$5;matches=$6,$runs,${rate:-0},${rss:-0,0},$result"
+   done
+done
+
+rm -rf $work
+exit $failed
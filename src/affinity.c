@@ -0,0 +1,165 @@
+/**
+ *  \file affinity.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Placement of the games on the NUMA nodes.
+ *
+ *  Implementation of the interface defined in affinity.h. The memory policies are set by the
+ *  <tt>set_mempolicy</tt> and <tt>mbind</tt> system calls; a kernel without NUMA support (ENOSYS) has nothing to
+ *  bind, and on a single node nothing is bound at all.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#define _GNU_SOURCE                                                                      /* sched_setaffinity */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "affinity.h"
+
+/** \brief maximum number of nodes considered (also the size of the node masks, in bits) */
+#define  NODE_MAX           64
+
+/** \brief length of a CPU list */
+#define  CPULIST_LEN        256
+
+/** \brief system node number and CPU list of each node with CPUs usable by the process */
+static int nodeId[NODE_MAX];
+static char nodeCpus[NODE_MAX][CPULIST_LEN];
+
+/** \brief number of nodes (0 before the first call) */
+static int nNodes = 0;
+
+/** \brief parse a CPU list (<tt>a-b,c,...</tt>) into a CPU set, returning -1 if it is malformed */
+static int parseCpus (const char *list, cpu_set_t *set)
+{
+    const char *p = list;
+    char *end;
+    long a, b;
+
+    CPU_ZERO (set);
+    while ((*p != '\0') && (*p != '\n')) {
+        a = b = strtol (p, &end, 10);
+        if (end == p) {
+            return -1;
+        }
+        if (*end == '-') {
+            p = end + 1;
+            b = strtol (p, &end, 10);
+            if (end == p) {
+                return -1;
+            }
+        }
+        for (; (a <= b) && (a < CPU_SETSIZE); a++) {
+            CPU_SET (a, set);
+        }
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return 0;
+}
+
+/** \brief CPU set of a node, restricted to the CPUs allowed to the process */
+static void nodeSet (int node, cpu_set_t *set)
+{
+    cpu_set_t allowed;
+
+    if ((parseCpus (nodeCpus[node], set) == -1) || (sched_getaffinity (0, sizeof (allowed), &allowed) == -1)) {
+        CPU_ZERO (set);
+        return;
+    }
+    CPU_AND (set, set, &allowed);
+}
+
+/** \brief read the nodes of the host, once */
+static void readNodes (void)
+{
+    char name[64];
+    cpu_set_t set;
+    FILE *fp;
+    int n;
+
+    for (n = 0; (n < NODE_MAX) && (nNodes < NODE_MAX); n++) {
+        snprintf (name, sizeof (name), "/sys/devices/system/node/node%d/cpulist", n);
+        if ((fp = fopen (name, "r")) == NULL) {
+            continue;                                                           /* node numbers may have holes */
+        }
+        if (fgets (nodeCpus[nNodes], CPULIST_LEN, fp) != NULL) {
+            nodeCpus[nNodes][strcspn (nodeCpus[nNodes], "\n")] = '\0';
+            nodeId[nNodes] = n;
+            nodeSet (nNodes, &set);
+            if (CPU_COUNT (&set) > 0) {                                         /* memory only nodes are skipped */
+                nNodes++;
+            }
+        }
+        fclose (fp);
+    }
+    if (nNodes == 0) {                                                 /* no node information: a single node */
+        nodeId[0] = -1;
+        strcpy (nodeCpus[0], "all");
+        nNodes = 1;
+    }
+}
+
+int affinityNodes (void)
+{
+    if (nNodes == 0) {
+        readNodes ();
+    }
+    return nNodes;
+}
+
+int affinityNode (int policy, int game)
+{
+    return (policy == AFFINITY_SPREAD) ? game % affinityNodes () : 0;
+}
+
+const char *affinityCpus (int node)
+{
+    affinityNodes ();
+    return nodeCpus[node];
+}
+
+int affinitySet (int node)
+{
+    unsigned long mask;
+    cpu_set_t set;
+
+    if ((affinityNodes () == 1) || (nodeId[node] == -1)) {                      /* nothing to choose from */
+        return 0;
+    }
+    nodeSet (node, &set);
+    if (sched_setaffinity (0, sizeof (set), &set) == -1) {
+        return -1;
+    }
+    mask = 1ul << nodeId[node];
+    if ((syscall (SYS_set_mempolicy, MPOL_PREFERRED, &mask, NODE_MAX + 1) == -1) && (errno != ENOSYS)) {
+        return -1;
+    }
+    return 0;
+}
+
+int affinityBind (void *add, size_t size, int node)
+{
+    uintptr_t page = (uintptr_t) sysconf (_SC_PAGESIZE),
+              start = (uintptr_t) add & ~(page - 1);                      /* mbind needs the start of a page */
+    unsigned long mask;
+
+    if ((affinityNodes () == 1) || (nodeId[node] == -1)) {
+        return 0;
+    }
+    mask = 1ul << nodeId[node];
+    if ((syscall (SYS_mbind, start, (uintptr_t) add + size - start, MPOL_BIND, &mask, NODE_MAX + 1, MPOL_MF_MOVE)
+         == -1) && (errno != ENOSYS)) {
+        return -1;
+    }
+    return 0;
+}
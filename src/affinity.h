@@ -0,0 +1,81 @@
+/**
+ *  \file affinity.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Placement of the games on the NUMA nodes.
+ *
+ *  A placed game process restricts its CPUs to the CPUs of one node and prefers the memory of that node, before
+ *  it creates the shared region and generates the entities: the entities processes (fork and exec, posix_spawn or
+ *  zygote) and threads inherit both, so all of them, the shared region and the semaphores stay on one node and
+ *  the cache lines they share never cross the interconnect. The shared region is also bound to the node.
+ *
+ *  The nodes are read from <tt>/sys/devices/system/node</tt>, without libnuma; a host where it is missing is a
+ *  single node with all the CPUs of the process.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef AFFINITY_H_
+#define AFFINITY_H_
+
+#include <stddef.h>
+
+/* Placement policy */
+
+/** \brief no placement, the scheduler moves the entities freely */
+#define  AFFINITY_NONE      0
+/** \brief all the games on the first node */
+#define  AFFINITY_PACK      1
+/** \brief game k on node k modulo the number of nodes (parallel games spread across the nodes) */
+#define  AFFINITY_SPREAD    2
+
+/**
+ *  \brief Number of NUMA nodes with CPUs usable by the process.
+ *
+ *  \return number of nodes (>= 1)
+ */
+extern int affinityNodes (void);
+
+/**
+ *  \brief Node of a game.
+ *
+ *  \param policy AFFINITY_PACK or AFFINITY_SPREAD
+ *  \param game number of the game (0 .. parallel games - 1)
+ *
+ *  \return node (0 .. affinityNodes () - 1)
+ */
+extern int affinityNode (int policy, int game);
+
+/**
+ *  \brief Placement of the calling process, and of the processes and threads it generates afterwards, on a node.
+ *
+ *  \param node node (0 .. affinityNodes () - 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int affinitySet (int node);
+
+/**
+ *  \brief Binding of the memory of a mapped region to a node (the pages already allocated are moved to it).
+ *
+ *  \param add address of the region
+ *  \param size size of the region (in bytes)
+ *  \param node node (0 .. affinityNodes () - 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int affinityBind (void *add, size_t size, int node);
+
+/**
+ *  \brief CPUs of a node, as in <tt>/sys/devices/system/node/node<i>n</i>/cpulist</tt> (e.g. <tt>0-7,16-23</tt>).
+ *
+ *  \param node node (0 .. affinityNodes () - 1)
+ *
+ *  \return CPU list ("all" on a host without node information)
+ */
+extern const char *affinityCpus (int node);
+
+#endif /* AFFINITY_H_ */
@@ -0,0 +1,77 @@
+/**
+ *  \file barrier.c (implementation file)
+ *
+ *  \brief Barrier management.
+ *
+ *  Futex based implementation of the interface defined in barrier.h. The futexes are not private to the
+ *  process, so the barrier works both in shared memory and in the memory of the process (thread engine).
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "barrier.h"
+#include "trace.h"
+
+static long futex (unsigned int *uaddr, int op, unsigned int val)
+{
+    return syscall (SYS_futex, uaddr, op, val, NULL, NULL, 0);
+}
+
+void barrierInit (BARRIER *b, unsigned int parties)
+{
+    b->phase = 0;
+    b->arrived = 0;
+    b->waiters = 0;
+    b->parties = parties;
+}
+
+int barrierArrive (BARRIER *b, unsigned int *p_phase)
+{
+    /* the round cannot end before this arrival, so it is the round read here */
+    unsigned int phase = __atomic_load_n (&b->phase, __ATOMIC_ACQUIRE);
+
+    *p_phase = phase;
+    if (__atomic_add_fetch (&b->arrived, 1, __ATOMIC_ACQ_REL) < b->parties)
+       return 0;
+
+    /* last party: no one arrives for the next round before the phase changes */
+    __atomic_store_n (&b->arrived, 0, __ATOMIC_RELAXED);
+    __atomic_store_n (&b->phase, phase + 1, __ATOMIC_SEQ_CST);
+    if ((__atomic_load_n (&b->waiters, __ATOMIC_SEQ_CST) > 0) && (futex (&b->phase, FUTEX_WAKE, INT_MAX) == -1))
+       return -1;
+    return 0;
+}
+
+static int waitPhase (BARRIER *b, unsigned int phase)
+{
+    while (__atomic_load_n (&b->phase, __ATOMIC_ACQUIRE) == phase) {
+        __atomic_fetch_add (&b->waiters, 1, __ATOMIC_SEQ_CST);
+        if ((futex (&b->phase, FUTEX_WAIT, phase) == -1) && (errno != EAGAIN) && (errno != EINTR)) {
+            __atomic_fetch_sub (&b->waiters, 1, __ATOMIC_RELAXED);
+            return -1;
+        }
+        __atomic_fetch_sub (&b->waiters, 1, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+int barrierWait (BARRIER *b, unsigned int phase)
+{
+    return TRACED (TRACE_BARRIER, 0, waitPhase (b, phase));
+}
+
+int barrierArriveAndWait (BARRIER *b)
+{
+    unsigned int phase;
+
+    if (barrierArrive (b, &phase) == -1)
+       return -1;
+    return barrierWait (b, phase);
+}
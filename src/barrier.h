@@ -0,0 +1,88 @@
+/**
+ *  \file barrier.h (interface file)
+ *
+ *  \brief Barrier management.
+ *
+ *  Process-shared barrier living in shared memory (or in the memory of the process, for the thread engine):
+ *  a fixed number of parties meet at the barrier, and none leaves it before all have arrived. It is a phase
+ *  (generalized sense-reversing) barrier on a futex: the last party to arrive starts a new phase and wakes up
+ *  every blocked party with a single broadcast, so one round costs O(1) wakeups instead of a semaphore
+ *  operation per party. The barrier is reusable, the next round starts as soon as the previous one ends.
+ *
+ *  Operations defined on barriers:
+ *     \li initialization of a barrier
+ *     \li arrival at the barrier, without blocking
+ *     \li wait for the end of the round of a previous arrival
+ *     \li arrival at the barrier and wait for the end of the round.
+ *
+ *  The arrival and the wait are apart so that a party may arrive at several barriers before blocking.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef BARRIER_H_
+#define BARRIER_H_
+
+/**
+ *  \brief Definition of <em>barrier</em> data type.
+ */
+typedef struct
+{   /** \brief number of the current round (the futex word) */
+    unsigned int phase;
+    /** \brief number of parties that already arrived in the current round */
+    unsigned int arrived;
+    /** \brief number of parties blocked waiting for the end of the round */
+    unsigned int waiters;
+    /** \brief number of parties of a round */
+    unsigned int parties;
+} BARRIER;
+
+/**
+ *  \brief Initialization of a barrier.
+ *
+ *  No party may be using the barrier.
+ *
+ *  \param b pointer to the barrier
+ *  \param parties number of parties of a round (>= 1)
+ */
+
+extern void barrierInit (BARRIER *b, unsigned int parties);
+
+/**
+ *  \brief Arrival at the barrier, without blocking.
+ *
+ *  The last party to arrive ends the round and wakes up the blocked parties.
+ *
+ *  \param b pointer to the barrier
+ *  \param p_phase pointer to the location where the round of the arrival is stored (for barrierWait)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int barrierArrive (BARRIER *b, unsigned int *p_phase);
+
+/**
+ *  \brief Wait for the end of the round of a previous arrival.
+ *
+ *  \param b pointer to the barrier
+ *  \param phase round of the arrival, as stored by barrierArrive
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int barrierWait (BARRIER *b, unsigned int phase);
+
+/**
+ *  \brief Arrival at the barrier and wait for the end of the round.
+ *
+ *  \param b pointer to the barrier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int barrierArriveAndWait (BARRIER *b);
+
+#endif /* BARRIER_H_ */
@@ -0,0 +1,100 @@
+/**
+ *  \file delay.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Simulated delays of the intervening entities.
+ *
+ *  The deterministic schedule draws <tt>u</tt> from a splitmix64 hash of the seed, the entity and the number of
+ *  the delay, so it does not depend on the interleaving of the entities nor on their use of <tt>random</tt>.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "probDataStruct.h"
+#include "delay.h"
+
+/** \brief scale factor of the delays of the entity */
+static ENTITY_LOCAL double scale = 1.0;
+
+/** \brief seed of the deterministic schedule (0 if the delays are random) */
+static ENTITY_LOCAL uint64_t seed = 0;
+
+/** \brief identification of the entity in the deterministic schedule */
+static ENTITY_LOCAL uint64_t entity;
+
+/** \brief number of delays already taken by the entity */
+static ENTITY_LOCAL uint64_t nDelays;
+
+/* internal functions */
+
+/** \brief parse the specification <tt>scale[:seed]</tt>; return false if it is not valid */
+static bool parse (const char *spec, double *p_scale, uint64_t *p_seed)
+{
+    char *tinp;                                                                    /* numerical parameters test flag */
+
+    *p_scale = strtod (spec, &tinp);
+    if ((tinp == spec) || (*p_scale < 0)) {
+        return false;
+    }
+    *p_seed = 0;
+    if (*tinp == ':') {
+        spec = tinp + 1;
+        *p_seed = strtoull (spec, &tinp, 0);
+        if ((tinp == spec) || (*p_seed == 0)) {
+            return false;
+        }
+    }
+    return *tinp == '\0';
+}
+
+/** \brief splitmix64 hash */
+static uint64_t mix (uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+/* external functions */
+
+/** \brief Parse a delay specification; return 0 if it is valid, -1 otherwise. */
+int delayCheck (const char *spec)
+{
+    double s;
+    uint64_t sd;
+
+    return parse (spec, &s, &sd) ? 0 : -1;
+}
+
+/** \brief Set the delays of an entity (the default ones if the specification is not valid). */
+void delayInit (const char *spec, char type, int id)
+{
+    if (!parse (spec, &scale, &seed)) {
+        scale = 1.0;
+        seed = 0;
+    }
+    entity = ((uint64_t) (unsigned char) type << 32) | (uint32_t) id;
+    nDelays = 0;
+}
+
+/** \brief Simulated delay of <tt>base + range * u</tt> microseconds, scaled. */
+void delay (double base, double range)
+{
+    double u;
+
+    if (seed != 0) {
+        u = (mix (seed ^ mix (entity ^ mix (nDelays++))) >> 11) * 0x1.0p-53;
+    }
+    else u = random () / (RAND_MAX + 1.0);
+    if (scale > 0) {
+        usleep ((unsigned int) (scale * (base + range * u)));
+    }
+}
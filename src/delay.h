@@ -0,0 +1,51 @@
+/**
+ *  \file delay.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Simulated delays of the intervening entities.
+ *
+ *  The time an entity takes to arrive or a match takes to be played is simulated by a sleep of
+ *  <tt>base + range * u</tt> microseconds, where <tt>u</tt> is uniform in [0, 1). The main program sets, with
+ *  a delay specification <tt>scale[:seed]</tt> passed to every entity:
+ *     \li a scale factor applied to all delays (0 suppresses them, there is no sleep at all)
+ *     \li an optional seed replacing the random generator by a deterministic schedule, where <tt>u</tt> only
+ *         depends on the seed, the entity and the number of delays the entity has already taken.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef DELAY_H_
+#define DELAY_H_
+
+/**
+ *  \brief Parse a delay specification.
+ *
+ *  \param spec delay specification, <tt>scale[:seed]</tt> (scale >= 0, seed > 0)
+ *
+ *  \return \c 0, if the specification is valid
+ *  \return -\c 1, otherwise
+ */
+extern int delayCheck (const char *spec);
+
+/**
+ *  \brief Set the delays of an entity.
+ *
+ *  Must be called by the entity before its first delay; with an invalid specification the delays are kept
+ *  as they are by default (scale 1, random).
+ *
+ *  \param spec delay specification, <tt>scale[:seed]</tt>
+ *  \param type entity type (<tt>'P'</tt>, <tt>'G'</tt> or <tt>'R'</tt>)
+ *  \param id entity id
+ */
+extern void delayInit (const char *spec, char type, int id);
+
+/**
+ *  \brief Simulated delay of <tt>base + range * u</tt> microseconds, scaled.
+ *
+ *  \param base minimum delay (us)
+ *  \param range range of the delay (us)
+ */
+extern void delay (double base, double range);
+
+#endif /* DELAY_H_ */
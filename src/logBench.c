@@ -0,0 +1,113 @@
+/**
+ *  \file logBench.c (implementation file)
+ *
+ *  \brief Logging benchmark.
+ *
+ *  Measures the cost of a call to <tt>saveState</tt> (followed by <tt>flushState</tt>, as the entities do) for
+ *  every logging mode and file format, with a single process and a state where one entity changes per call.
+ *  In ring mode the ring is drained when half full; the drain is not counted, it is the main process work.
+ *
+ *  Upon execution, one optional parameter is accepted:
+ *    \li number of calls (default 100000).
+ *
+ *  The log is written to <tt>bench.log</tt> in the present directory, which is removed at the end.
+ *  Results are written to stdout as CSV lines: <tt>backend,test,config,iterations,value,unit</tt>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+#include "logging.h"
+
+/** \brief name of the log file */
+#define  BENCH_LOG      "bench.log"
+
+static double now (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/** \brief time (ns) per call of saveState for a mode, a format and a number of entities */
+static double bench (int mode, int format, int nP, int nG, int nR, long n)
+{
+    size_t size = TEAM_OFFSET (nP, nG, nR);
+    int nEnt = nP + nG + nR, e;
+    SHARED_DATA *sh;
+    double t0, drain = 0, t;
+    long i;
+
+    if (posix_memalign ((void **) &sh, CACHE_LINE, size) != 0) {
+        perror ("error on allocating the shared data");
+        exit (EXIT_FAILURE);
+    }
+    memset (sh, 0, size);
+    sh->fSt.nPlayers = nP;
+    sh->fSt.nGoalies = nG;
+    sh->fSt.nReferees = nR;
+    for (e = 0; e < nEnt; e++) {
+        sh->fSt.st[e] = ARRIVING;
+    }
+    sh->log.mode = mode;
+    sh->log.format = format;
+    sh->log.stride = SLOT_SIZE (nP, nG, nR);
+    sh->log.slotOff = RING_OFFSET (nP, nG, nR) - offsetof (SHARED_DATA, log);
+    sh->log.lastOff = LAST_OFFSET (nP, nG, nR) - offsetof (SHARED_DATA, log);
+    attachLog (&sh->log);
+    createLog (BENCH_LOG, &sh->fSt);
+
+    t0 = now ();
+    for (i = 0; i < n; i++) {
+        e = i % nEnt;
+        sh->fSt.st[e] = (sh->fSt.st[e] == ARRIVING) ? WAITING_TEAM : ARRIVING;
+        saveState (BENCH_LOG, &sh->fSt);
+        flushState (BENCH_LOG);
+        if ((mode == LOG_RING) && ((i + 1) % (LOG_RING_SIZE / 2) == 0)) {
+            t = now ();
+            drainLog (BENCH_LOG, &sh->fSt);
+            drain += now () - t;
+        }
+    }
+    t = (now () - t0 - drain) / n;
+    drainLog (BENCH_LOG, &sh->fSt);
+    syncLog ();
+
+    attachLog (NULL);
+    free (sh);
+    return t;
+}
+
+int main (int argc, char *argv[])
+{
+    static const char *modeName[] = { "direct", "deferred", "ring" },
+                      *formatName[] = { "text", "binary", "delta" };
+    static const int count[][3] = {{ NUMPLAYERS, NUMGOALIES, NUMREFEREES }, { 100, 30, 8 }, { 1000, 300, 30 }};
+    long n = 100000;
+    int m, f, c;
+
+    if (argc == 2) {
+        n = strtol (argv[1], NULL, 0);
+    }
+
+    for (c = 0; c < sizeof (count) / sizeof (count[0]); c++) {
+        for (m = LOG_DIRECT; m <= LOG_RING; m++) {
+            for (f = LOG_TEXT; f <= LOG_DELTA; f++) {
+                printf ("log,saveState,mode=%s;format=%s;entities=%d,%ld,%.1f,ns\n", modeName[m], formatName[f],
+                        count[c][0] + count[c][1] + count[c][2], n,
+                        bench (m, f, count[c][0], count[c][1], count[c][2], n));
+                fflush (stdout);
+            }
+        }
+    }
+    unlink (BENCH_LOG);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,796 @@
+/**
+ *  \file logDecode.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Offline decoder of binary log files (<tt>-f binary</tt> and <tt>-f delta</tt>) and log filter.
+ *
+ *  Reads the LOG_HEADER and the fixed size records that follow it, a block of records at a time, and writes
+ *  one line per saved state to stdout (in delta format, the state rebuilt from the changed entities) in one of
+ *  the following layouts:
+ *     \li the text layout of the log file (default), byte for byte the file a text log would have been
+ *     \li the layout of <tt>filter_log.awk</tt> (<tt>-d</tt>), where a state equal to the previous one of the
+ *         same entity is replaced by a dot.
+ *
+ *  With <tt>-t</tt> each record is preceded by its time (ms since the first record, binary format only).
+ *
+ *  With <tt>-c</tt> nothing is written: the saved states of a binary or delta log are checked against the game
+ *  of the log, described by the options of probSemSharedMemSoccerGame (<tt>-P</tt> players and <tt>-G</tt> goalies
+ *  in each team, <tt>-m</tt> matches of a tournament), and the violations are reported on stderr:
+ *     \li each saved state changes one entity at most, by a transition of the state table (state.c): an entity
+ *         joins a team only to play in it, and a late entity stays late
+ *     \li every match has a team 1 and a team 2 of exactly the given number of players and goalies, and no
+ *         entity joins a match twice: the entries in the playing states are taken by the matches in the windows
+ *         of records from the start of each match to the next state of its referee after its end (see
+ *         checkTeams); one team is formed per former, every match has a referee starting and ending it, and
+ *         outside tournament mode no entity joins two teams
+ *     \li an entity is only late after the cutoff: when it enters LATE, the entities of its type that arrived for
+ *         a team (waiting or forming) are at least enough for all the teams of the game
+ *     \li at the end, the entities left without a team are late, and in tournament mode all of them.
+ *
+ *  A summary line is written to stdout and the program exits with failure if any violation was found.
+ *
+ *  A text log is recognized by the lack of a binary header and, with <tt>-d</tt>, filtered as
+ *  <tt>filter_log.awk</tt> does: the column count and field sizes are taken from the header line, the input
+ *  is read in large blocks and the fields are located in place, so it streams logs of any size.
+ *
+ *  Upon execution, one optional parameter is accepted:
+ *    \li name of the log file (default stdin).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "logging.h"
+#include "state.h"
+
+/** \brief number of records read at a time */
+#define  BLOCK_RECS     4096
+
+/** \brief size of the stdout buffer */
+#define  OUT_BUF        (1 << 20)
+
+/** \brief size of the blocks read from a text log */
+#define  TEXT_BLOCK     (1 << 20)
+
+/** \brief number of violations reported in full by the checks */
+#define  CHECK_REPORTS  20
+
+/** \brief header of the log file */
+static LOG_HEADER hdr;
+
+/** \brief number of columns of a record */
+static int nCols;
+
+/** \brief field size of each column in the dot layout (4, or 5 if preceded by an extra separator) */
+static int *fieldSize;
+
+/** \brief previous state of each column, in the dot layout and in the checks */
+static int *prev;
+
+/** \brief layouts: dot layout, time stamps; checks instead of a layout */
+static bool dots = false, times = false, check = false;
+
+/** \brief game of the log, for the checks: players and goalies in each team, matches (0 outside tournament mode) */
+static int teamSize[STATE_REFEREE] = { NUMTEAMPLAYERS, NUMTEAMGOALIES }, nMatches = 0;
+
+/** \brief number of records checked and of violations found */
+static unsigned long nRecs = 0, nErrors = 0;
+
+/** \brief number of entities of each type in each state, and entries of each type in each state */
+static int inState[STATE_TYPES][STATE_CODES];
+static unsigned long entries[STATE_TYPES][STATE_CODES];
+
+/** \brief number of teams joined by each entity */
+static int *joins;
+
+/**
+ *  \brief Definition of <em>checked match</em> data type.
+ *
+ *  The members of a match save their playing state after its referee saved STARTING_GAME and before the
+ *  referee saves its next state after ENDING_GAME (the barriers of the team slots), so the entries in the
+ *  playing states of a match are taken from that window of records.
+ */
+typedef struct
+{   /** \brief column of the referee */
+    int referee;
+    /** \brief records of STARTING_GAME and of the next state of the referee after ENDING_GAME */
+    unsigned long start, end;
+    /** \brief players and goalies still missing in team 1 and in team 2 */
+    int missing[NUMTEAMS][STATE_REFEREE];
+    /** \brief number of members taken */
+    int nMembers;
+    /** \brief columns of the members taken */
+    int *member;
+
+} MATCH;
+
+/**
+ *  \brief Definition of <em>playing entry</em> data type.
+ */
+typedef struct
+{   /** \brief record of the entry */
+    unsigned long rec;
+    /** \brief column of the entity */
+    int col;
+    /** \brief team of the entity in its match (0 for team 1, 1 for team 2) */
+    int side;
+
+} PLAY;
+
+/** \brief matches started, in the order of their start */
+static MATCH *match;
+
+/** \brief entries in the playing states, in the order of the records */
+static PLAY *play;
+
+/** \brief number of matches and of playing entries, and their capacity */
+static int nMatch, nPlay, matchCap, playCap;
+
+/** \brief match being refereed by each referee (-1 if none) */
+static int *refMatch;
+
+/** \brief state of all entities of the record being written */
+static ENTITY_STAT *st;
+
+/** \brief line buffer */
+static char *line;
+
+/** \brief print the text header, formatting the column names as filter_log.awk does for the dot layout */
+static void printHeader (void)
+{
+    size_t size = HEADER_LEN(hdr.nPlayers, hdr.nGoalies, hdr.nReferees);
+    char *buf = malloc (size), *names, *name;
+    int c;
+
+    if (buf == NULL) {
+        perror ("error on allocating the header buffer");
+        exit (EXIT_FAILURE);
+    }
+    logTextHeader (buf, size, hdr.nPlayers, hdr.nGoalies, hdr.nReferees);
+    names = strstr (buf, "\n\n") + 2;                                          /* title line and blank line */
+    fwrite (buf, 1, names - buf, stdout);
+    if (times) {
+        printf ("%10s ", "ms");
+    }
+    if (!dots) {
+        fputs (names, stdout);
+    }
+    else {
+        for (c = 0, name = strtok (names, " \n"); name != NULL; c++, name = strtok (NULL, " \n")) {
+            printf ("%*s ", fieldSize[c], name);
+        }
+        printf ("\n");
+    }
+    free (buf);
+}
+
+/** \brief format one record in the dot layout; return its length */
+static int dotLine (char *line, unsigned char *st)
+{
+    char *l = line;
+    int c;
+
+    for (c = 0; c < nCols; c++) {
+        memset (l, ' ', fieldSize[c] - 1);
+        l += fieldSize[c] - 1;
+        *l++ = (st[c] == prev[c]) ? '.' : (char) st[c];
+        *l++ = ' ';
+        prev[c] = st[c];
+    }
+    *l++ = '\n';
+    return l - line;
+}
+
+/** \brief type of the entity of a column */
+static int colType (int c)
+{
+    return (c < (int) hdr.nPlayers) ? STATE_PLAYER
+                                    : (c < (int) (hdr.nPlayers + hdr.nGoalies)) ? STATE_GOALIE : STATE_REFEREE;
+}
+
+/** \brief name of the entity of a column, as in the header of the log (P00, G00, R01, ...) */
+static const char *colName (int c)
+{
+    static char name[16];
+    int nPG = hdr.nPlayers + hdr.nGoalies;
+
+    if (c < (int) hdr.nPlayers) {
+        snprintf (name, sizeof (name), "P%02d", c);
+    }
+    else if (c < nPG) {
+        snprintf (name, sizeof (name), "G%02d", c - (int) hdr.nPlayers);
+    }
+    else snprintf (name, sizeof (name), "R%02d", c - nPG + 1);
+    return name;
+}
+
+/** \brief report a violation of the present record (or of the end of the log, after the last one) */
+static void violation (bool end, const char *fmt, ...)
+{
+    va_list ap;
+
+    if (nErrors++ < CHECK_REPORTS) {
+        if (end) {
+            fprintf (stderr, "end of log: ");
+        }
+        else fprintf (stderr, "record %lu: ", nRecs - 1);
+        va_start (ap, fmt);
+        vfprintf (stderr, fmt, ap);
+        va_end (ap);
+        fputc ('\n', stderr);
+    }
+}
+
+/** \brief make sure the array <tt>*p_arr</tt> of elements of <tt>size</tt> bytes holds at least <tt>n</tt> elements */
+static void *grow (void *p_arr, int *p_cap, int n, size_t size)
+{
+    void **arr = p_arr;
+
+    if (n > *p_cap) {
+        *p_cap = (*p_cap > 0) ? 2 * *p_cap : 64;
+        if ((*arr = realloc (*arr, *p_cap * size)) == NULL) {
+            perror ("error on allocating the check buffers");
+            exit (EXIT_FAILURE);
+        }
+    }
+    return *arr;
+}
+
+/** \brief record the start and the end of the matches and the entries in the playing states */
+static void checkMatch (int c, int t, int from, int to)
+{
+    int r = c - (int) (hdr.nPlayers + hdr.nGoalies), side;
+    MATCH *m;
+
+    if ((t == STATE_REFEREE) && (to == STARTING_GAME)) {
+        m = (MATCH *) grow (&match, &matchCap, nMatch + 1, sizeof (MATCH)) + nMatch;
+        m->referee = c;
+        m->start = nRecs - 1;
+        m->end = ULONG_MAX;
+        for (side = 0; side < NUMTEAMS; side++) {
+            m->missing[side][STATE_PLAYER] = teamSize[STATE_PLAYER];
+            m->missing[side][STATE_GOALIE] = teamSize[STATE_GOALIE];
+        }
+        m->nMembers = 0;
+        if ((m->member = malloc (NUMTEAMS * (teamSize[STATE_PLAYER] + teamSize[STATE_GOALIE]) * sizeof (int))) == NULL) {
+            perror ("error on allocating the check buffers");
+            exit (EXIT_FAILURE);
+        }
+        refMatch[r] = nMatch++;
+    }
+    else if ((t == STATE_REFEREE) && (from == ENDING_GAME) && (refMatch[r] >= 0)) {
+        match[refMatch[r]].end = nRecs - 1;
+        refMatch[r] = -1;
+    }
+    else if ((t != STATE_REFEREE) && ((to == PLAYING_1) || (to == PLAYING_2))) {
+        grow (&play, &playCap, nPlay + 1, sizeof (PLAY));
+        play[nPlay++] = (PLAY) { nRecs - 1, c, (to == PLAYING_1) ? 0 : 1 };
+    }
+}
+
+/**
+ *  \brief check the teams of every match: each playing entry is taken by the match, among those whose window
+ *  holds it, that still misses an entity of its type in its team and ends first, and was not yet joined by the
+ *  entity.
+ *
+ *  With one referee the windows do not overlap and each entry belongs to a single match. With several referees
+ *  the concurrent matches share their windows, and a violation is found when no assignment of the entries to
+ *  them fits, e.g. two teams 1 in a match while another match in the same window has two teams 2 is taken as
+ *  two matches with a team 1 and a team 2.
+ */
+static void checkTeams (void)
+{
+    static const char *name[STATE_REFEREE] = { "player", "goalie" };
+    int p, k, i, t, best, twice;
+    PLAY *e;
+    MATCH *m;
+
+    for (p = 0, e = play; p < nPlay; p++, e++) {
+        t = colType (e->col);
+        best = twice = -1;
+        for (k = 0; (k < nMatch) && (match[k].start < e->rec); k++) {
+            m = &match[k];
+            if (m->end <= e->rec) {
+                continue;
+            }
+            for (i = 0; (i < m->nMembers) && (m->member[i] != e->col); i++)
+              ;
+            if (i < m->nMembers) {
+                twice = k;
+            }
+            else if ((m->missing[e->side][t] > 0) && ((best == -1) || (m->end < match[best].end))) {
+                best = k;
+            }
+        }
+        if (best == -1) {
+            if (twice != -1) {
+                violation (true, "%s joined the match of %s started at record %lu twice (record %lu)", colName (e->col),
+                           colName (match[twice].referee), match[twice].start, e->rec);
+            }
+            else violation (true, "%s played in team %d at record %lu, in no match missing a %s in that team",
+                            colName (e->col), e->side + 1, e->rec, name[t]);
+            continue;
+        }
+        match[best].missing[e->side][t]--;
+        match[best].member[match[best].nMembers++] = e->col;
+    }
+    for (k = 0, m = match; k < nMatch; k++, m++) {
+        for (p = 0; p < NUMTEAMS; p++) {
+            for (t = STATE_PLAYER; t <= STATE_GOALIE; t++) {
+                if (m->missing[p][t] != 0) {
+                    violation (true, "the match of %s started at record %lu has %d %ss in team %d, %d expected",
+                               colName (m->referee), m->start, teamSize[t] - m->missing[p][t], name[t], p + 1,
+                               teamSize[t]);
+                }
+            }
+        }
+        free (m->member);
+    }
+}
+
+/** \brief check the change of state of the entity of column c */
+static void checkChange (int c, int from, int to)
+{
+    int t = colType (c), nTeams = NUMTEAMS * ((nMatches > 0) ? nMatches : 1);
+    const STATE_DEF *def = &stateTable[t][to & (STATE_CODES - 1)];
+
+    if ((def->name == NULL) || (from == 0) || (strchr (def->from, from) == NULL)) {    /* strchr matches the NUL */
+        violation (false, "%s changed from %s to %s, not a transition of the state table", colName (c),
+                   stateName (t, from), stateName (t, to));
+    }
+    if (t != STATE_REFEREE) {
+        if (to == LATE) {                  /* the arrivals are saved in the order they take their places (team.h) */
+            if (entries[t][WAITING_TEAM] + entries[t][FORMING_TEAM] < (unsigned long) nTeams * teamSize[t]) {
+                violation (false, "%s late before all the %d teams were formed", colName (c), nTeams);
+            }
+        }
+        if (((to == WAITING_START_1) || (to == WAITING_START_2)) && (++joins[c] > 1) && (nMatches == 0)) {
+            violation (false, "%s joined a second team", colName (c));
+        }
+    }
+    checkMatch (c, t, from, to);
+    inState[t][from & (STATE_CODES - 1)]--;
+    inState[t][to & (STATE_CODES - 1)]++;
+    entries[t][to & (STATE_CODES - 1)]++;
+}
+
+/** \brief check one state of all entities against the previous one */
+static void checkRecord (unsigned char *rec)
+{
+    int c, changed = 0;
+
+    if (nRecs++ == 0) {                                                          /* the initial state */
+        for (c = 0; c < nCols; c++) {
+            if (rec[c] != ARRIVING) {
+                violation (false, "%s starts in %s", colName (c),
+                           stateName (colType (c), rec[c]));
+            }
+            inState[colType (c)][rec[c] & (STATE_CODES - 1)]++;
+            prev[c] = rec[c];
+        }
+        return;
+    }
+    for (c = 0; c < nCols; c++) {
+        if (rec[c] != prev[c]) {
+            if (++changed == 2) {
+                violation (false, "more than one entity changed state");
+            }
+            checkChange (c, prev[c], rec[c]);
+            prev[c] = rec[c];
+        }
+    }
+}
+
+/** \brief check the teams, the matches and the late entities of the whole game, and write the summary */
+static void checkEnd (void)
+{
+    static const char *name[STATE_TYPES] = { "players", "goalies", "referees" };
+    int n[STATE_TYPES] = { hdr.nPlayers, hdr.nGoalies, hdr.nReferees },
+        games = (nMatches > 0) ? nMatches : 1, t, late;
+    unsigned long formed = entries[STATE_PLAYER][FORMING_TEAM] + entries[STATE_GOALIE][FORMING_TEAM];
+
+    if (nRecs == 0) {
+        violation (true, "no saved state");
+    }
+    for (t = STATE_PLAYER; t <= STATE_GOALIE; t++) {
+        if ((entries[t][WAITING_START_1] != (unsigned long) (games * teamSize[t])) ||
+            (entries[t][WAITING_START_2] != (unsigned long) (games * teamSize[t]))) {
+            violation (true, "%lu %s joined the teams 1 and %lu the teams 2 of %d matches (%d in each team)",
+                       entries[t][WAITING_START_1], name[t], entries[t][WAITING_START_2], games, teamSize[t]);
+        }
+        late = (nMatches > 0) ? n[t] : n[t] - NUMTEAMS * teamSize[t];     /* the tournament ends with all late */
+        if (inState[t][LATE] != late) {
+            violation (true, "%d %s late, %d expected", inState[t][LATE], name[t], late);
+        }
+    }
+    checkTeams ();
+    if (formed != (unsigned long) (NUMTEAMS * games)) {
+        violation (true, "%lu teams formed, %d expected", formed, NUMTEAMS * games);
+    }
+    if ((entries[STATE_REFEREE][STARTING_GAME] != (unsigned long) games) ||
+        (entries[STATE_REFEREE][ENDING_GAME] != (unsigned long) games)) {
+        violation (true, "%lu matches started and %lu ended, %d expected", entries[STATE_REFEREE][STARTING_GAME],
+                   entries[STATE_REFEREE][ENDING_GAME], games);
+    }
+    if (nErrors > CHECK_REPORTS) {
+        fprintf (stderr, "(%lu more violations)\n", nErrors - CHECK_REPORTS);
+    }
+    printf ("%lu records, %lu teams, %lu matches, %d late: %s (%lu violations)\n", nRecs, formed,
+            entries[STATE_REFEREE][ENDING_GAME], inState[STATE_PLAYER][LATE] + inState[STATE_GOALIE][LATE],
+            (nErrors == 0) ? "ok" : "FAILED", nErrors);
+}
+
+/** \brief write one state of all entities in the chosen layout, preceded by its time stamp if requested */
+static void putRecord (unsigned char *rec, uint64_t ts)
+{
+    static uint64_t ts0 = 0;                                                        /* time stamp of the first record */
+    int c, len;
+
+    if (check) {
+        checkRecord (rec);
+        return;
+    }
+    if (times) {
+        if (ts0 == 0) ts0 = ts;
+        printf ("%10.3f ", (ts - ts0) / 1e6);
+    }
+    if (dots) {
+        len = dotLine (line, rec);
+    }
+    else {
+        for (c = 0; c < nCols; c++) {
+            st[c] = rec[c];
+        }
+        len = logTextLine (line, st, hdr.nPlayers, hdr.nGoalies, hdr.nReferees);
+    }
+    fwrite (line, 1, len, stdout);
+}
+
+/** \brief decode the fixed size records of a binary log */
+static void decodeStates (FILE *in)
+{
+    unsigned char *block = malloc ((size_t) BLOCK_RECS * hdr.recSize), *rec;
+    uint64_t ts;
+    size_t n, r;
+
+    if (block == NULL) {
+        perror ("error on allocating the decoder buffers");
+        exit (EXIT_FAILURE);
+    }
+    while ((n = fread (block, hdr.recSize, BLOCK_RECS, in)) > 0) {
+        for (r = 0, rec = block; r < n; r++, rec += hdr.recSize) {
+            memcpy (&ts, rec + sizeof (uint32_t), sizeof (ts));
+            putRecord (rec + LOG_REC_HDR, ts);
+        }
+    }
+    free (block);
+}
+
+/** \brief decode the delta records of a delta log, writing the state of all entities once per sequence number */
+static void decodeDeltas (FILE *in)
+{
+    DELTA_REC *block = malloc (BLOCK_RECS * sizeof (DELTA_REC)), *d;
+    unsigned char *cur = calloc (nCols, 1);                                        /* state of all entities */
+    unsigned int base[] = { 0, 0, hdr.nPlayers, hdr.nPlayers + hdr.nGoalies },       /* first column of each type */
+                 count[] = { 1, hdr.nPlayers, hdr.nGoalies, hdr.nReferees };          /* columns of each type */
+    bool any = false;
+    uint32_t seq = 0;
+    size_t n, r;
+
+    if ((block == NULL) || (cur == NULL)) {
+        perror ("error on allocating the decoder buffers");
+        exit (EXIT_FAILURE);
+    }
+    while ((n = fread (block, sizeof (DELTA_REC), BLOCK_RECS, in)) > 0) {
+        for (r = 0, d = block; r < n; r++, d++) {
+            if ((d->type > DELTA_REFEREE) || (d->id >= count[d->type])) {
+                fprintf (stderr, "Corrupted delta record (seq %u)\n", (unsigned int) d->seq);
+                exit (EXIT_FAILURE);
+            }
+            if (any && (d->seq != seq)) {
+                putRecord (cur, 0);
+            }
+            seq = d->seq;
+            any = true;
+            if (d->type != DELTA_NONE) {
+                cur[base[d->type] + d->id] = d->state;
+            }
+        }
+    }
+    if (any) {
+        putRecord (cur, 0);
+    }
+    free (cur);
+    free (block);
+}
+
+/** \brief make sure the buffer <tt>*p_buf</tt> holds at least <tt>size</tt> bytes */
+static char *reserve (char **p_buf, size_t *p_cap, size_t size)
+{
+    if (size > *p_cap) {
+        if ((*p_buf = realloc (*p_buf, size)) == NULL) {
+            perror ("error on allocating the filter buffers");
+            exit (EXIT_FAILURE);
+        }
+        *p_cap = size;
+    }
+    return *p_buf;
+}
+
+/** \brief output buffer of the text filter */
+static char *out;
+
+/** \brief size and length of out */
+static size_t outCap, outLen;
+
+/** \brief append <tt>len</tt> bytes to the output buffer, writing it when full */
+static inline void emit (const char *buf, size_t len)
+{
+    if (outLen + len > outCap) {
+        fwrite (out, 1, outLen, stdout);
+        outLen = 0;
+        reserve (&out, &outCap, len);
+    }
+    memcpy (out + outLen, buf, len);
+    outLen += len;
+}
+
+/**
+ *  \brief Definition of <em>text field</em> data type.
+ */
+typedef struct
+{   /** \brief offset of the field in its line */
+    size_t off;
+    /** \brief length of the field */
+    size_t len;
+
+} FIELD;
+
+/** \brief fields of the present line and of the previous filtered line (nCols + 1 entries) */
+static FIELD *field, *prevField;
+
+/** \brief copy of the previous filtered line */
+static char *prevLine;
+
+/** \brief size of prevLine */
+static size_t prevCap;
+
+/** \brief split a line in fields separated by blanks, storing at most nCols + 1 of them; return their number */
+static int splitLine (char *l, size_t len, FIELD *f, int max)
+{
+    size_t i = 0, start;
+    int nf = 0;
+
+    while (true) {
+        while ((i < len) && ((l[i] == ' ') || (l[i] == '\t'))) i++;
+        if (i == len) break;
+        start = i;
+        while ((i < len) && (l[i] != ' ') && (l[i] != '\t')) i++;
+        if (nf < max) {
+            f[nf].off = start;
+            f[nf].len = i - start;
+        }
+        nf++;
+    }
+    return nf;
+}
+
+/** \brief the line is the header (column names), first field P followed by digits */
+static bool headerLine (char *l, size_t len)
+{
+    size_t i = 0;
+
+    while ((i < len) && (l[i] == ' ')) i++;
+    if ((i == len) || (l[i++] != 'P') || (i == len) || (l[i] < '0') || (l[i] > '9')) return false;
+    while ((i < len) && (l[i] >= '0') && (l[i] <= '9')) i++;
+    return (i < len) && (l[i] == ' ');
+}
+
+/**
+ *  \brief Filter one line of a text log (without its newline), as filter_log.awk does.
+ *
+ *  The column count and field sizes come from the header line; lines with that many fields are written with
+ *  a dot for each field equal to the same field of the previous such line, the others are copied.
+ */
+static void filterLine (char *l, size_t len)
+{
+    static const char spaces[] = "        ";
+    FIELD *tmp;
+    int nf, c;
+
+    if ((nCols == 0) && headerLine (l, len)) {
+        nCols = splitLine (l, len, NULL, 0);
+        fieldSize = malloc (nCols * sizeof (int));
+        field = malloc ((nCols + 1) * sizeof (FIELD));
+        prevField = calloc (nCols + 1, sizeof (FIELD));
+        if ((fieldSize == NULL) || (field == NULL) || (prevField == NULL)) {
+            perror ("error on allocating the filter buffers");
+            exit (EXIT_FAILURE);
+        }
+        splitLine (l, len, field, nCols);
+        for (c = 0; c < nCols; c++) {           /* first goalie and referee columns have an extra separator */
+            fieldSize[c] = ((c > 0) && (l[field[c].off] != l[field[c-1].off])) ? 5 : 4;
+        }
+    }
+    if ((nCols == 0) || ((nf = splitLine (l, len, field, nCols + 1)) != nCols)) {
+        emit (l, len);
+        emit ("\n", 1);
+        return;
+    }
+
+    for (c = 0; c < nCols; c++) {
+        FIELD *f = &field[c], *p = &prevField[c];
+        bool same = (f->len == p->len) && (memcmp (l + f->off, prevLine + p->off, f->len) == 0);
+        size_t w = same ? 1 : f->len;
+
+        if (w < (size_t) fieldSize[c]) {
+            emit (spaces, fieldSize[c] - w);
+        }
+        if (same) emit (".", 1);
+        else emit (l + f->off, f->len);
+        emit (" ", 1);
+    }
+    emit ("\n", 1);
+
+    memcpy (reserve (&prevLine, &prevCap, len), l, len);
+    tmp = prevField;
+    prevField = field;
+    field = tmp;
+}
+
+/**
+ *  \brief Filter a text log read in large blocks, starting with the <tt>nStart</tt> bytes already read.
+ *
+ *  Without the dot layout the log is copied.
+ */
+static void filterText (FILE *in, char *start, size_t nStart)
+{
+    char *buf = NULL, *l, *nl;
+    size_t cap = 0, len = nStart, n;
+
+    reserve (&buf, &cap, TEXT_BLOCK);
+    reserve (&out, &outCap, TEXT_BLOCK);
+    memcpy (buf, start, nStart);
+    do {
+        n = fread (buf + len, 1, cap - len, in);
+        len += n;
+        if (!dots) {
+            fwrite (buf, 1, len, stdout);
+            len = 0;
+            continue;
+        }
+        for (l = buf; (nl = memchr (l, '\n', buf + len - l)) != NULL; l = nl + 1) {
+            filterLine (l, nl - l);
+        }
+        len -= l - buf;
+        memmove (buf, l, len);                                 /* incomplete line, kept for the next block */
+        if (len == cap) {
+            reserve (&buf, &cap, 2 * cap);                                  /* line longer than the buffer */
+        }
+    } while (n > 0);
+    if (len > 0) {
+        filterLine (buf, len);                                           /* last line without a newline */
+    }
+    fwrite (out, 1, outLen, stdout);
+    free (buf);
+}
+
+/**
+ *  \brief Main program.
+ */
+int main (int argc, char *argv[])
+{
+    FILE *in = stdin;
+    bool delta;
+    size_t n;
+    int c, opt;
+
+    while ((opt = getopt (argc, argv, "dtcP:G:m:")) != -1) {
+        switch (opt) {
+            case 'd':
+                dots = true;
+                break;
+            case 't':
+                times = true;
+                break;
+            case 'c':
+                check = true;
+                break;
+            case 'P':
+            case 'G':
+            case 'm':
+                if ((c = atoi (optarg)) <= 0) {
+                    fprintf (stderr, "Wrong value for option -%c (%s)\n", opt, optarg);
+                    exit (EXIT_FAILURE);
+                }
+                if (opt == 'm') {
+                    nMatches = c;
+                }
+                else teamSize[(opt == 'P') ? STATE_PLAYER : STATE_GOALIE] = c;
+                break;
+            default:
+                fprintf (stderr, "Usage: %s [-d] [-t] [-c [-P team players] [-G team goalies] [-m matches]] "
+                                 "[logfile]\n", argv[0]);
+                exit (EXIT_FAILURE);
+        }
+    }
+    if ((argc == optind + 1) && ((in = fopen (argv[optind], "r")) == NULL)) {
+        perror ("error on opening the log file");
+        exit (EXIT_FAILURE);
+    }
+
+    setvbuf (in, NULL, _IONBF, 0);                                      /* all reads are large blocks */
+    n = fread (&hdr, 1, sizeof (hdr), in);
+    delta = (n == sizeof (hdr)) && (memcmp (hdr.magic, LOG_MAGIC_DELTA, sizeof (hdr.magic)) == 0);
+    if (!delta && ((n < sizeof (hdr)) || (memcmp (hdr.magic, LOG_MAGIC, sizeof (hdr.magic)) != 0))) {
+        if (times || check) {
+            fprintf (stderr, times ? "Text logs have no time stamps\n" : "Only binary and delta logs are checked\n");
+            exit (EXIT_FAILURE);
+        }
+        filterText (in, (char *) &hdr, n);
+        if (ferror (in)) {
+            perror ("error on reading the log file");
+            exit (EXIT_FAILURE);
+        }
+        fclose (in);
+        fflush (stdout);
+        return EXIT_SUCCESS;
+    }
+    if ((hdr.version != LOG_VERSION) ||
+        (hdr.recSize != (delta ? sizeof (DELTA_REC) : REC_LEN(hdr.nPlayers, hdr.nGoalies, hdr.nReferees)))) {
+        fprintf (stderr, "Unsupported binary log version %u\n", hdr.version);
+        exit (EXIT_FAILURE);
+    }
+    if (delta && times) {
+        fprintf (stderr, "Delta logs have no time stamps\n");
+        exit (EXIT_FAILURE);
+    }
+    nCols = hdr.nPlayers + hdr.nGoalies + hdr.nReferees;
+
+    st = malloc (nCols * sizeof (ENTITY_STAT));
+    line = malloc (LINE_LEN(hdr.nPlayers, hdr.nGoalies, hdr.nReferees) + 2 * nCols + 16);
+    fieldSize = malloc (nCols * sizeof (int));
+    prev = calloc (nCols, sizeof (int));
+    joins = calloc (nCols, sizeof (int));
+    refMatch = malloc ((hdr.nReferees + 1) * sizeof (int));
+    if ((st == NULL) || (line == NULL) || (fieldSize == NULL) || (prev == NULL) || (joins == NULL) ||
+        (refMatch == NULL)) {
+        perror ("error on allocating the decoder buffers");
+        exit (EXIT_FAILURE);
+    }
+    for (c = 0; c <= (int) hdr.nReferees; c++) {
+        refMatch[c] = -1;
+    }
+    for (c = 0; c < nCols; c++) {
+        fieldSize[c] = ((c == (int) hdr.nPlayers) || (c == (int) (hdr.nPlayers + hdr.nGoalies))) ? 5 : 4;
+    }
+    setvbuf (stdout, NULL, _IOFBF, OUT_BUF);
+
+    if (!check) {
+        printHeader ();
+    }
+    if (delta) {
+        decodeDeltas (in);
+    }
+    else decodeStates (in);
+    if (ferror (in)) {
+        perror ("error on reading the log file");
+        exit (EXIT_FAILURE);
+    }
+
+    fclose (in);
+    if (check) {
+        checkEnd ();
+    }
+    fflush (stdout);
+    return (nErrors == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
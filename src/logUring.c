@@ -0,0 +1,229 @@
+/**
+ *  \file logUring.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Asynchronous sink of the log drain.
+ *
+ *  Implementation of the interface defined in logUring.h: a ring of a few entries, mapped as
+ *  <tt>io_uring_setup</tt> describes it, the two buffers registered (IORING_REGISTER_BUFFERS) and written by
+ *  IORING_OP_WRITE_FIXED. The buffers are pinned in memory by the registration; if the limit of locked memory
+ *  does not allow it they are written by IORING_OP_WRITE instead.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "logUring.h"
+
+/** \brief number of entries of the submission queue (one write in flight at most) */
+#define  URING_ENTRIES      4
+
+/** \brief state of the sink: not set up yet, set up, not available */
+#define  SINK_NONE          0
+#define  SINK_READY         1
+#define  SINK_OFF           2
+
+/** \brief state of the sink */
+static int sink = SINK_NONE;
+
+/** \brief descriptor of the ring */
+static int ringFd = -1;
+
+/** \brief submission queue: tail, mask and index array (the kernel consumes the entries), and its entries */
+static unsigned int *sqTail, *sqMask, *sqArray;
+static struct io_uring_sqe *sqes;
+
+/** \brief completion queue: head, tail, mask and entries */
+static unsigned int *cqHead, *cqTail, *cqMask;
+static struct io_uring_cqe *cqes;
+
+/** \brief buffers, their size and the one to be filled next */
+static char *buf[URING_BUFFERS];
+static size_t bufCap = 0;
+static int cur = 0;
+
+/** \brief the buffers are registered with the ring */
+static bool registered = false;
+
+/** \brief write in flight: descriptor, buffer and length (inLen is 0 if there is none) */
+static int inFd;
+static char *inBuf;
+static size_t inLen = 0;
+
+/** \brief map the queues of a ring set up with the parameters <tt>p</tt>, returning -1 on failure */
+static int mapRing (struct io_uring_params *p)
+{
+    size_t sqSize = p->sq_off.array + p->sq_entries * sizeof (unsigned int),
+           cqSize = p->cq_off.cqes + p->cq_entries * sizeof (struct io_uring_cqe);
+    char *sq, *cq;
+
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        sqSize = cqSize = (sqSize > cqSize) ? sqSize : cqSize;
+    }
+    sq = mmap (NULL, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        return -1;
+    }
+    cq = sq;
+    if (!(p->features & IORING_FEAT_SINGLE_MMAP) &&
+        ((cq = mmap (NULL, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING))
+         == MAP_FAILED)) {
+        return -1;
+    }
+    sqes = mmap (NULL, p->sq_entries * sizeof (struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return -1;
+    }
+    sqTail = (unsigned int *) (sq + p->sq_off.tail);
+    sqMask = (unsigned int *) (sq + p->sq_off.ring_mask);
+    sqArray = (unsigned int *) (sq + p->sq_off.array);
+    cqHead = (unsigned int *) (cq + p->cq_off.head);
+    cqTail = (unsigned int *) (cq + p->cq_off.tail);
+    cqMask = (unsigned int *) (cq + p->cq_off.ring_mask);
+    cqes = (struct io_uring_cqe *) (cq + p->cq_off.cqes);
+    return 0;
+}
+
+/** \brief set up the ring, once; the sink is off if io_uring is missing or too old (no current position writes) */
+static void setup (void)
+{
+    struct io_uring_params p;
+
+    memset (&p, 0, sizeof (p));
+    if (((ringFd = (int) syscall (SYS_io_uring_setup, URING_ENTRIES, &p)) == -1) ||
+        !(p.features & IORING_FEAT_RW_CUR_POS) || (mapRing (&p) == -1)) {
+        if (ringFd == -1) {
+            perror ("io_uring is not available, the log is written by write");
+        }
+        else fprintf (stderr, "io_uring can not be used, the log is written by write\n");
+        sink = SINK_OFF;
+        return;
+    }
+    sink = SINK_READY;
+}
+
+/** \brief (re)allocate and register the buffers with at least <tt>size</tt> bytes each, no write being in flight */
+static void grow (size_t size)
+{
+    size_t page = (size_t) sysconf (_SC_PAGESIZE);
+    struct iovec iov[URING_BUFFERS];
+    int b;
+
+    if (registered) {
+        syscall (SYS_io_uring_register, ringFd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+        registered = false;
+    }
+    size = (size + page - 1) & ~(page - 1);
+    for (b = 0; b < URING_BUFFERS; b++) {
+        free (buf[b]);
+        if (posix_memalign ((void **) &buf[b], page, size) != 0) {
+            perror ("error on allocating log buffer");
+            exit (EXIT_FAILURE);
+        }
+        iov[b].iov_base = buf[b];
+        iov[b].iov_len = size;
+    }
+    bufCap = size;
+    registered = (syscall (SYS_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, iov, URING_BUFFERS) == 0);
+}
+
+char *uringBuffer (size_t size)
+{
+    if (sink == SINK_NONE) {
+        setup ();
+    }
+    if (sink == SINK_OFF) {
+        return NULL;
+    }
+    if (size > bufCap) {
+        uringWait ();
+        grow (size);
+    }
+    return buf[cur];
+}
+
+void uringSubmit (int fd, size_t len)
+{
+    struct io_uring_sqe *sqe;
+    unsigned int tail, idx;
+
+    uringWait ();
+    tail = *sqTail;
+    idx = tail & *sqMask;
+    sqe = &sqes[idx];
+    memset (sqe, 0, sizeof (*sqe));
+    sqe->opcode = registered ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t) buf[cur];
+    sqe->len = (uint32_t) len;
+    sqe->off = (uint64_t) -1;                                    /* current position, as write (and O_APPEND) */
+    sqe->buf_index = (uint16_t) cur;
+    sqArray[idx] = idx;
+    __atomic_store_n (sqTail, tail + 1, __ATOMIC_RELEASE);
+    while (syscall (SYS_io_uring_enter, ringFd, 1, 0, 0, NULL, 0) == -1) {
+        if (errno != EINTR) {
+            perror ("error on submitting a write to log file");
+            exit (EXIT_FAILURE);
+        }
+    }
+    inFd = fd;
+    inBuf = buf[cur];
+    inLen = len;
+    cur = (cur + 1) % URING_BUFFERS;
+}
+
+void uringWait (void)
+{
+    struct io_uring_cqe *cqe;
+    unsigned int head;
+    ssize_t n;
+
+    if (inLen == 0) {
+        return;
+    }
+    head = *cqHead;
+    while (head == __atomic_load_n (cqTail, __ATOMIC_ACQUIRE)) {
+        if ((syscall (SYS_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) == -1) &&
+            (errno != EINTR)) {
+            perror ("error on waiting for a write to log file");
+            exit (EXIT_FAILURE);
+        }
+    }
+    cqe = &cqes[head & *cqMask];
+    n = cqe->res;
+    __atomic_store_n (cqHead, head + 1, __ATOMIC_RELEASE);
+    for (;;) {
+        if (n < 0) {
+            if (n == -EINTR) {
+                n = 0;
+            }
+            else {
+                errno = (int) -n;
+                perror ("error on writing to log file");
+                exit (EXIT_FAILURE);
+            }
+        }
+        inBuf += n;
+        inLen -= (size_t) n;
+        if (inLen == 0) {
+            break;
+        }
+        n = write (inFd, inBuf, inLen);                         /* the rest of a short write, as writeLog does */
+        if (n == -1) {
+            n = -errno;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+/**
+ *  \file logUring.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Asynchronous sink of the log drain.
+ *
+ *  Built with <tt>make LOG_SINK=uring</tt>, the records drained from the log ring (<tt>-l ring</tt>) are written
+ *  by io_uring instead of <tt>write</tt>: the drain formats them in one of two buffers, registered with the
+ *  kernel, while the write of the other one is in flight, and only waits for the file when a batch is ready
+ *  before the write of the previous one is complete.
+ *  The entities only ever touch the ring in shared memory, so no process of the game makes a write system call
+ *  on its hot path.
+ *
+ *  The io_uring interface is used through its system calls (<tt>linux/io_uring.h</tt>), without liburing. One
+ *  write is in flight at most, at the current position of the file, so the records keep their order in files
+ *  and pipes alike. A kernel without io_uring (or forbidding it) makes the drain write synchronously.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef LOGURING_H_
+#define LOGURING_H_
+
+#include <stddef.h>
+
+/** \brief number of buffers of the sink: one is filled by the drain while the other one is written */
+#define  URING_BUFFERS      2
+
+/**
+ *  \brief Buffer to be filled with the next records.
+ *
+ *  The sink is set up on the first call. The buffer is not being written; it grows to <tt>size</tt> bytes if it
+ *  is smaller (once the write in flight is complete).
+ *
+ *  \param size number of bytes needed
+ *
+ *  \return pointer to the buffer
+ *  \return NULL, if io_uring is not available (the records are then written by <tt>write</tt>)
+ */
+extern char *uringBuffer (size_t size);
+
+/**
+ *  \brief Write of the buffer returned by the last uringBuffer, appended to a file.
+ *
+ *  The function waits for the write in flight, if any, submits this one and returns at once; the next call of
+ *  uringBuffer returns the other buffer. The program ends on a write error.
+ *
+ *  \param fd descriptor of the file (it must stay open until the write is complete, see uringWait)
+ *  \param len number of bytes
+ */
+extern void uringSubmit (int fd, size_t len);
+
+/**
+ *  \brief Wait for the write in flight, if any (before the file is closed, truncated or read).
+ */
+extern void uringWait (void);
+
+#endif /* LOGURING_H_ */
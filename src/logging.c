@@ -7,7 +7,15 @@
  *
  *  Defined operations:
  *     \li file initialization
- *     \li writing the present full state as a single line at the end of the file.
+ *     \li writing the present full state as a single line at the end of the file
+ *     \li writing the states saved in deferred mode
+ *     \li draining the shared log ring buffer
+ *     \li waiting for the writes of the drain.
+ *
+ *  The log file is opened once per process and kept open for its whole life; each line is
+ *  formatted in memory and appended with a single <tt>write</tt> (<tt>O_APPEND</tt>).
+ *  Built with LOG_URING defined (<tt>make LOG_SINK=uring</tt>), the drained records are written
+ *  asynchronously through io_uring (logUring.h).
  *
  *  \author Nuno Lau - December 2024
  */
@@ -16,72 +24,436 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
 
 #include <sys/types.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include <unistd.h>
+#include <limits.h>
+#include <time.h>
 
 
 #include "probConst.h"
 #include "probDataStruct.h"
+#include "logging.h"
+#include "trace.h"
+#ifdef LOG_URING
+#include "logUring.h"
+#endif
+
+/** \brief number of deferred records a process may hold before they are written (the states saved in one critical
+           region: flushState is called after each one, so the file is never written inside it) */
+#define  PENDING_MAX        8
+
+/**
+ *  \brief Definition of <em>deferred log record</em> data type.
+ *
+ *  Snapshot of the state taken inside the critical region, written after leaving it.
+ */
+typedef struct {
+    /** \brief sequence number of the record (line number after the header) */
+    unsigned int seq;
+    /** \brief time of the snapshot (binary format only) */
+    uint64_t ts;
+    /** \brief position of the record in the file (seq, or the first delta record in delta format) */
+    unsigned int pos;
+    /** \brief number of delta records in st (delta format) */
+    int nDelta;
+    /** \brief number of players, goalies and referees at the time of the snapshot */
+    int nPlayers, nGoalies, nReferees;
+    /** \brief state of all intervening entities (the delta records in delta format) */
+    ENTITY_STAT st[];
+} LOG_REC;
+
+/** \brief descriptor of the log file, kept open for the whole life of the process (-1 if not open) */
+static int logFd = -1;
+
+/** \brief name of the log file associated with logFd */
+static char logName[256];
+
+/** \brief open flags of logFd (O_APPEND in direct mode) */
+static int logFlags;
+
+/** \brief logFd supports positioned writes (regular file) */
+static bool logSeekable;
+
+/** \brief records saved in deferred mode and not yet written, each one pendingSize bytes long */
+static ENTITY_LOCAL char *pending = NULL;
+
+/** \brief size of a deferred record */
+static ENTITY_LOCAL size_t pendingSize = 0;
+
+/** \brief number of records in pending */
+static ENTITY_LOCAL int nPending = 0;
+
+/** \brief length of the file header, same in all processes (-1 until computed) */
+static ENTITY_LOCAL int hdrLen = -1;
+
+/** \brief shared log control block (NULL if not attached, meaning direct mode) */
+static LOG_BUF *logBuf = NULL;
+
+/** \brief line buffer */
+static ENTITY_LOCAL char *lineBuf = NULL;
+
+/** \brief size of lineBuf */
+static ENTITY_LOCAL size_t lineCap = 0;
+
+/** \brief lines drained from the ring, written with a single write */
+static char *drainBuf = NULL;
+
+/** \brief size of drainBuf */
+static size_t drainCap = 0;
 
 /* internal functions */
 
-static FILE *openLog(char nFic[], char mode[])
+static int openLog(char nFic[], int flags)
 {
-    FILE *fic;
-    char *fName;                                                                                      /* log file name */
+    int fd;                                                                                         /* file descriptor */
 
     if ((nFic == NULL) || (strlen (nFic) == 0)) {
-        return stdout;
-    }
-    else  {
-        fName = nFic;
+        return STDOUT_FILENO;
     }
 
-    fprintf(stderr,"%d opening log %s %s\n",getpid(),nFic,mode);
+    fprintf(stderr,"%d opening log %s %s\n",getpid(),nFic,(flags & O_TRUNC) ? "w" : "a");
 
-    if ((fic = fopen (fName, mode)) == NULL) {
+    /* O_CLOEXEC: the entity processes launched by execl open their own descriptor */
+    if ((fd = open (nFic, O_WRONLY | O_CREAT | O_CLOEXEC | flags, 0644)) == -1) {
         perror ("error on opening log file");
         exit (EXIT_FAILURE);
     }
-    return fic;
+    return fd;
 }
 
-static void closeLog(FILE *fic)
+static void closeLog(int fd)
 {
-    if(fic==stderr || fic == stdout) {
-         fflush(fic);
-         return;
+    if (fd == -1 || fd == STDOUT_FILENO || fd == STDERR_FILENO) {
+        return;
     }
 
-    if (fclose (fic) == EOF) {
+    if (close (fd) == -1) {
         perror ("error on closing of log file");
         exit (EXIT_FAILURE);
     }
 }
 
-static void printHeader(FILE *fic, FULL_STAT *p_fSt)
+/**
+ *  \brief Get the descriptor of the log file, opening it on first use.
+ *
+ *  The file is only (re)opened when the process has not opened it yet, when a different file is requested
+ *  or when it must be truncated.
+ */
+static int getLog(char nFic[], int flags)
+{
+    if ((nFic == NULL) || (strlen (nFic) == 0)) {
+        logSeekable = false;
+        return STDOUT_FILENO;
+    }
+
+    if ((logFd == -1) || (flags & O_TRUNC) || ((flags & O_APPEND) != (logFlags & O_APPEND)) ||
+        (strcmp (logName, nFic) != 0)) {
+#ifdef LOG_URING
+        uringWait();                                                     /* the drain may still be writing it */
+#endif
+        closeLog(logFd);
+        logFd = openLog(nFic, flags);
+        logFlags = flags;
+        logSeekable = (lseek (logFd, 0, SEEK_CUR) != -1);
+        strncpy(logName, nFic, sizeof(logName)-1);
+    }
+    return logFd;
+}
+
+/** \brief make sure the buffer <tt>*p_buf</tt> holds at least <tt>size</tt> bytes */
+static char *reserve(char **p_buf, size_t *p_cap, size_t size)
+{
+    if (size > *p_cap) {
+        if ((*p_buf = realloc (*p_buf, size)) == NULL) {
+            perror ("error on allocating log buffer");
+            exit (EXIT_FAILURE);
+        }
+        *p_cap = size;
+    }
+    return *p_buf;
+}
+
+/** \brief deferred record number <tt>r</tt> */
+static inline LOG_REC *pendingRec(int r)
+{
+    return (LOG_REC *) (pending + r * pendingSize);
+}
+
+/** \brief ring slot that holds record <tt>seq</tt> */
+static inline LOG_SLOT *ringSlot(unsigned int seq)
+{
+    return (LOG_SLOT *) ((char *) logBuf + logBuf->slotOff + (size_t) (seq % LOG_RING_SIZE) * logBuf->stride);
+}
+
+static long futex (unsigned int *uaddr, int op, unsigned int val)
+{
+    return syscall (SYS_futex, uaddr, op, val, NULL, NULL, 0);
+}
+
+/** \brief block until the slot of record <tt>seq</tt> is free (the ring is full until the drain advances tail) */
+static void ringWait(unsigned int seq)
+{
+    unsigned int tail;
+
+    while (seq - (tail = __atomic_load_n (&logBuf->tail, __ATOMIC_SEQ_CST)) >= LOG_RING_SIZE) {
+        __atomic_fetch_add (&logBuf->full, 1, __ATOMIC_SEQ_CST);
+        futex (&logBuf->tail, FUTEX_WAIT, tail);                    /* returns at once if tail has moved meanwhile */
+        __atomic_fetch_sub (&logBuf->full, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/** \brief write the whole buffer with as few write calls as possible (a single one, unless interrupted) */
+static void writeLog(int fd, char *buf, size_t len, off_t offset)
+{
+    ssize_t n;
+
+    while (len > 0) {
+        n = (offset < 0) ? write (fd, buf, len) : pwrite (fd, buf, len, offset);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror ("error on writing to log file");
+            exit (EXIT_FAILURE);
+        }
+        buf += n;
+        len -= (size_t) n;
+        if (offset >= 0) offset += n;
+    }
+}
+
+/** \brief append one state column (right aligned in a 4 char field) to the line buffer */
+static inline char *putColumn(char *buf, unsigned int stat)
+{
+    buf[0] = buf[1] = buf[2] = ' ';
+    buf[3] = (char) stat;
+    return buf + 4;
+}
+
+/**
+ *  \brief Format the text header: title line, blank line and column names.
+ *
+ *  \return header length (in bytes)
+ */
+int logTextHeader (char *buf, size_t size, int nPlayers, int nGoalies, int nReferees)
+{
+    int len = 0;
+
+    /* title line + blank line */
+
+    len += snprintf (buf+len, size-len, "%21cSoccerGame - Description of the internal state\n\n", ' ');
+
+    int p;
+    for(p=0; p < nPlayers; p++) {
+        len += snprintf(buf+len, size-len, " %s%02d", "P", p);
+    }
+
+    len += snprintf(buf+len, size-len, " ");
+
+    int g;
+    for(g=0; g < nGoalies; g++) {
+        len += snprintf(buf+len, size-len, " %s%02d", "G", g);
+    }
+
+    len += snprintf(buf+len, size-len, " ");
+
+    int r;
+    for(r=0; r < nReferees; r++) {
+        len += snprintf(buf+len, size-len, " %s%02d", "R", r+1);
+    }
+
+    len += snprintf(buf+len, size-len, " ");
+
+    len += snprintf(buf+len, size-len, "\n");
+
+    return len;
+}
+
+/**
+ *  \brief Format a log record as a text line.
+ *
+ *  All lines of a given configuration have the same length, so the position of a line in the file
+ *  only depends on its sequence number.
+ *
+ *  \return line length (in bytes)
+ */
+int logTextLine (char *line, ENTITY_STAT *st, int nPlayers, int nGoalies, int nReferees)
 {
-    
+    char *c = line;
+
     int p;
-    for(p=0; p < p_fSt->nPlayers; p++) {
-        fprintf(fic, " %s%02d", "P", p);
+    for(p=0; p < nPlayers; p++) {
+        c = putColumn(c, st[p]);
     }
 
-    fprintf(fic," ");
+    *c++ = ' ';
 
     int g;
-    for(g=0; g < p_fSt->nGoalies; g++) {
-        fprintf(fic, " %s%02d", "G", g);
+    for(g=0; g < nGoalies; g++) {
+        c = putColumn(c, st[nPlayers + g]);
     }
 
-    fprintf(fic," ");
+    *c++ = ' ';
 
-    fprintf(fic," %s%02d","R",1);
+    int r;
+    for(r=0; r < nReferees; r++) {
+        c = putColumn(c, st[nPlayers + nGoalies + r]);
+    }
 
-    fprintf(fic," ");
+    *c++ = '\n';
 
-    fprintf(fic,"\n");
+    return c - line;
+}
+
+/** \brief logging mode set by the main program */
+static inline int logMode(void)
+{
+    return (logBuf == NULL) ? LOG_DIRECT : logBuf->mode;
+}
+
+/** \brief log file format set by the main program */
+static inline int logFormat(void)
+{
+    return (logBuf == NULL) ? LOG_TEXT : logBuf->format;
+}
+
+/** \brief maximum length of a log record (text line, binary record or the delta records of a state) */
+static inline size_t recordLen(int nPlayers, int nGoalies, int nReferees)
+{
+    switch (logFormat()) {
+        case LOG_BINARY:
+            return REC_LEN(nPlayers, nGoalies, nReferees);
+        case LOG_DELTA:
+            return (size_t) (nPlayers + nGoalies + nReferees) * sizeof (DELTA_REC);
+        default:
+            return LINE_LEN(nPlayers, nGoalies, nReferees);
+    }
+}
+
+/** \brief state of the entities in the last delta records written (all zero before the first one) */
+static inline ENTITY_STAT *lastState(void)
+{
+    return (ENTITY_STAT *) ((char *) logBuf + logBuf->lastOff);
+}
+
+/**
+ *  \brief Format the changes of the state since the last delta records as delta records.
+ *
+ *  Must be called in the order of the sequence numbers, it updates the last state. A state with no change
+ *  gives a DELTA_NONE record, so that the decoder sees every saved state.
+ *
+ *  \return number of records
+ */
+static int deltaRecords(DELTA_REC *d, unsigned int seq, ENTITY_STAT *st, int nPlayers, int nGoalies, int nReferees)
+{
+    ENTITY_STAT *last = lastState();
+    int n = nPlayers + nGoalies + nReferees, e, k = 0;
+
+    for (e = 0; e < n; e++) {
+        if (st[e] != last[e]) {
+            d[k].seq = seq;
+            d[k].state = (uint8_t) st[e];
+            if (e < nPlayers) {
+                d[k].type = DELTA_PLAYER;
+                d[k].id = e;
+            }
+            else if (e < nPlayers + nGoalies) {
+                d[k].type = DELTA_GOALIE;
+                d[k].id = e - nPlayers;
+            }
+            else {
+                d[k].type = DELTA_REFEREE;
+                d[k].id = e - nPlayers - nGoalies;
+            }
+            last[e] = st[e];
+            k++;
+        }
+    }
+    if (k == 0) {
+        d[0].seq = seq;
+        d[0].type = DELTA_NONE;
+        d[0].state = 0;
+        d[0].id = 0;
+        k = 1;
+    }
+    return k;
+}
+
+/** \brief time stamp of a record (ns of CLOCK_MONOTONIC), only taken for binary logs */
+static inline uint64_t timeStamp(void)
+{
+    struct timespec t;
+
+    if (logFormat() != LOG_BINARY) {
+        return 0;
+    }
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000u + (uint64_t) t.tv_nsec;
+}
+
+/** \brief format the file header in the log format; return its length */
+static int printHeader(char *buf, size_t size, int nPlayers, int nGoalies, int nReferees)
+{
+    LOG_HEADER hdr;
+
+    if (logFormat() == LOG_TEXT) {
+        return logTextHeader(buf, size, nPlayers, nGoalies, nReferees);
+    }
+    memset (&hdr, 0, sizeof (hdr));
+    memcpy (hdr.magic, (logFormat() == LOG_DELTA) ? LOG_MAGIC_DELTA : LOG_MAGIC, sizeof (hdr.magic));
+    hdr.version = LOG_VERSION;
+    hdr.recSize = (logFormat() == LOG_DELTA) ? sizeof (DELTA_REC) : REC_LEN(nPlayers, nGoalies, nReferees);
+    hdr.nPlayers = nPlayers;
+    hdr.nGoalies = nGoalies;
+    hdr.nReferees = nReferees;
+    memcpy (buf, &hdr, sizeof (hdr));
+    return sizeof (hdr);
+}
+
+/**
+ *  \brief Format a log record in the log format.
+ *
+ *  Binary records are REC_LEN bytes long: sequence number, time stamp and one byte per entity.
+ *  In delta format, the records of the entities changed since the previous call are formatted.
+ *
+ *  \return record length (in bytes)
+ */
+static int printRecord(char *buf, unsigned int seq, uint64_t ts, ENTITY_STAT *st, int nPlayers, int nGoalies, int nReferees)
+{
+    int n = nPlayers + nGoalies + nReferees, e;
+
+    if (logFormat() == LOG_TEXT) {
+        return logTextLine(buf, st, nPlayers, nGoalies, nReferees);
+    }
+    if (logFormat() == LOG_DELTA) {
+        return deltaRecords((DELTA_REC *) buf, seq, st, nPlayers, nGoalies, nReferees) * sizeof (DELTA_REC);
+    }
+    memcpy (buf, &seq, sizeof (seq));
+    memcpy (buf + sizeof (seq), &ts, sizeof (ts));
+    for (e = 0; e < n; e++) {
+        buf[LOG_REC_HDR + e] = (char) st[e];
+    }
+    return LOG_REC_HDR + n;
+}
+
+/** \brief offset in the log file of the record at position <tt>pos</tt>, records being <tt>lineLen</tt> bytes long */
+static off_t lineOffset(LOG_REC *rec, int lineLen)
+{
+    char *hdr;
+
+    if (hdrLen == -1) {
+        if ((hdr = malloc (HEADER_LEN(rec->nPlayers, rec->nGoalies, rec->nReferees))) == NULL) {
+            perror ("error on allocating log header");
+            exit (EXIT_FAILURE);
+        }
+        hdrLen = printHeader(hdr, HEADER_LEN(rec->nPlayers, rec->nGoalies, rec->nReferees), rec->nPlayers, rec->nGoalies, rec->nReferees);
+        free (hdr);
+    }
+    return (off_t) hdrLen + (off_t) rec->pos * lineLen;
 }
 
 /* external functions */
@@ -97,58 +469,215 @@ static void printHeader(FILE *fic, FULL_STAT *p_fSt)
  *       \li a blank line.
  *
  *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
  */
 void createLog (char nFic[], FULL_STAT *p_fSt)
 {
-    FILE *fic;                                                                                      /* file descriptor */
+    size_t size = HEADER_LEN(p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees);
+    char *buf = reserve(&lineBuf, &lineCap, size);                                                  /* header buffer */
+    int len;
 
-    fic = openLog(nFic,"w");
+    len = printHeader(buf, size, p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees);
 
-    /* title line + blank line */
-
-    fprintf (fic, "%21cSoccerGame - Description of the internal state\n\n", ' ');
-    printHeader(fic, p_fSt);
-
-    closeLog(fic);
+    writeLog(getLog(nFic, O_TRUNC | ((logMode() == LOG_DEFERRED) ? 0 : O_APPEND)), buf, len, -1);
 }
 
 /**
  *  \brief Writing the present full state as a single line at the end of the file.
  *
  *  If <tt>nFic</tt> is a null pointer or a null string, the lines are written to stdout
+ *  The file is opened on the first call and the descriptor is reused by the following ones.
+ *
+ *  In deferred mode (<tt>LOG_DEFERRED</tt>) and when the log is a regular file, only a
+ *  snapshot of the state and a sequence number are taken; the line is written by <tt>flushState</tt>, which must be
+ *  called after leaving each critical region (at most PENDING_MAX states are saved in one).
+ *  In ring mode (<tt>LOG_RING</tt>) the snapshot is copied to the ring buffer of the log control block set
+ *  by <tt>attachLog</tt>; the line is written by the process calling <tt>drainLog</tt>.
+ *  In any mode the function must be called inside the critical region.
  *
  *  The following layout is obeyed for the full state in a single line
  *    \li players state
  *    \li goalies state 
- *    \li referee state 
+ *    \li referees state 
  *
  *  \param nFic name of the logging file
  *  \param p_fSt pointer to the location where the full internal state of the problem is stored
  */
 void saveState (char nFic[], FULL_STAT *p_fSt)
 {
-    FILE *fic;                                                                                      /* file descriptor */
-
-    fic = openLog(nFic,"a");
+    size_t statSize = STAT_SIZE(p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees);
+    char *line;                                                                                       /* line buffer */
+    unsigned int seq;
+    int fd;
+
+    traceState (p_fSt);
+    if (logMode() == LOG_RING) {
+        seq = __atomic_fetch_add (&logBuf->seq, 1, __ATOMIC_RELAXED);
+        LOG_SLOT *slot = ringSlot(seq);
+
+        ringWait(seq);
+        slot->ts = timeStamp();
+        memcpy (slot->st, p_fSt->st, statSize);
+        __atomic_store_n (&slot->seq, seq + 1, __ATOMIC_RELEASE);
+        return;
+    }
 
-    int p;
-    for(p=0; p < p_fSt->nPlayers; p++) {
-        fprintf(fic,"%4c",p_fSt->st.playerStat[p]);
+    if (logMode() == LOG_DEFERRED) {
+        fd = getLog(nFic, 0);
+        if (logSeekable) {
+            LOG_REC *rec;
+
+            assert (nPending < PENDING_MAX);             /* flushState was not called after the critical region */
+            if (pending == NULL) {
+                size_t recSize = (logFormat() == LOG_DELTA) ? recordLen(p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees)
+                                                            : statSize;
+
+                pendingSize = (sizeof (LOG_REC) + recSize + _Alignof (LOG_REC) - 1) & ~(_Alignof (LOG_REC) - 1);
+                if ((pending = malloc (PENDING_MAX * pendingSize)) == NULL) {
+                    perror ("error on allocating deferred log records");
+                    exit (EXIT_FAILURE);
+                }
+            }
+            rec = pendingRec(nPending++);
+            rec->seq = rec->pos = logBuf->seq++;
+            rec->ts = timeStamp();
+            rec->nPlayers = p_fSt->nPlayers;
+            rec->nGoalies = p_fSt->nGoalies;
+            rec->nReferees = p_fSt->nReferees;
+            if (logFormat() == LOG_DELTA) {                 /* the changes are only known inside the critical region */
+                rec->nDelta = deltaRecords((DELTA_REC *) rec->st, rec->seq, p_fSt->st, p_fSt->nPlayers, p_fSt->nGoalies,
+                                           p_fSt->nReferees);
+                rec->pos = logBuf->nDelta;
+                logBuf->nDelta += rec->nDelta;
+            }
+            else memcpy (rec->st, p_fSt->st, statSize);
+            return;
+        }
     }
+    else fd = getLog(nFic, O_APPEND);
 
-    fprintf(fic," ");
+    seq = (logBuf != NULL) ? logBuf->seq++ : 0;
+    line = reserve(&lineBuf, &lineCap, recordLen(p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees));
+    writeLog(fd, line, printRecord(line, seq, timeStamp(), p_fSt->st, p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees), -1);
+}
 
-    int g;
-    for(g=0; g < p_fSt->nGoalies; g++) {
-        fprintf(fic,"%4c",p_fSt->st.goalieStat[g]);
+/**
+ *  \brief Writing the records saved in deferred mode.
+ *
+ *  Each line is written at the position given by its sequence number (the position reserved for its records in
+ *  delta format), so the file keeps the order in which the states were saved whatever the order in which
+ *  processes leave the critical region.
+ *  Nothing is done in direct and ring modes.
+ *
+ *  \param nFic name of the logging file
+ */
+void flushState (char nFic[])
+{
+    char *line;                                                                                       /* line buffer */
+    LOG_REC *rec;
+    int fd, len, r;
+
+    if (nPending == 0) {
+        return;
     }
 
-    fprintf(fic," ");
+    fd = getLog(nFic, 0);
+    for (r = 0; r < nPending; r++) {
+        rec = pendingRec(r);
+        if (logFormat() == LOG_DELTA) {
+            writeLog(fd, (char *) rec->st, rec->nDelta * sizeof (DELTA_REC), lineOffset(rec, sizeof (DELTA_REC)));
+            continue;
+        }
+        line = reserve(&lineBuf, &lineCap, recordLen(rec->nPlayers, rec->nGoalies, rec->nReferees));
+        len = printRecord(line, rec->seq, rec->ts, rec->st, rec->nPlayers, rec->nGoalies, rec->nReferees);
+        writeLog(fd, line, len, lineOffset(rec, len));
+    }
+    nPending = 0;
+}
 
-    fprintf(fic,"%4c",p_fSt->st.refereeStat);
+/**
+ *  \brief Setting the shared log control block.
+ *
+ *  The logging mode is the one stored in the block; without a block the direct mode is used.
+ *  The sizes derived from the configuration are computed again on the next record.
+ *
+ *  \param p_log pointer to the log control block in the shared memory region
+ */
+void attachLog (LOG_BUF *p_log)
+{
+    logBuf = p_log;
+    if (nPending == 0) {                          /* the record and header sizes may change with the block */
+        free (pending);
+        pending = NULL;
+        hdrLen = -1;
+    }
+}
 
-    fprintf(fic,"\n");
+/**
+ *  \brief Writing the records published in the shared log ring buffer.
+ *
+ *  All consecutive records already published are formatted and appended to the file with a single write.
+ *  With LOG_URING the write is submitted to io_uring and the function returns without waiting for it: the
+ *  records are formatted in the other buffer on the next call (see syncLog).
+ *  Only one process may drain the ring.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *
+ *  \return number of records written
+ */
+int drainLog (char nFic[], FULL_STAT *p_fSt)
+{
+    size_t size = LOG_RING_SIZE * recordLen(p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees);
+    char *buf = NULL;                                                                       /* drained records */
+    unsigned int tail, n;
+    LOG_SLOT *slot;
+    int len = 0;
+
+    if (logMode() != LOG_RING) {
+        return 0;
+    }
 
-    closeLog(fic);
+#ifdef LOG_URING
+    buf = uringBuffer(size);                                                     /* NULL without io_uring */
+#endif
+    if (buf == NULL) {
+        buf = reserve(&drainBuf, &drainCap, size);
+    }
+    tail = logBuf->tail;
+    for (n = 0; n < LOG_RING_SIZE; n++, tail++) {
+        slot = ringSlot(tail);
+        if (__atomic_load_n (&slot->seq, __ATOMIC_ACQUIRE) != tail + 1) {
+            break;                                                              /* not published yet */
+        }
+        len += printRecord(buf + len, tail, slot->ts, slot->st, p_fSt->nPlayers, p_fSt->nGoalies, p_fSt->nReferees);
+    }
+    __atomic_store_n (&logBuf->tail, tail, __ATOMIC_SEQ_CST);
+    if ((n > 0) && (__atomic_load_n (&logBuf->full, __ATOMIC_SEQ_CST) > 0)) {
+        futex (&logBuf->tail, FUTEX_WAKE, INT_MAX);                            /* a producer waits for room */
+    }
+
+    if (len > 0) {
+#ifdef LOG_URING
+        if (buf != drainBuf) {
+            uringSubmit(getLog(nFic, O_APPEND), len);
+            return (int) n;
+        }
+#endif
+        writeLog(getLog(nFic, O_APPEND), buf, len, -1);
+    }
+    return (int) n;
 }
 
+/**
+ *  \brief Waiting for the writes of the drain.
+ *
+ *  On return all the records drained so far are in the file. Nothing is done unless the drain writes
+ *  asynchronously (LOG_URING).
+ */
+void syncLog (void)
+{
+#ifdef LOG_URING
+    uringWait();
+#endif
+}
@@ -7,7 +7,17 @@
  *
  *  Defined operations:
  *     \li file initialization
- *     \li writing the present full state as a single line at the end of the file.
+ *     \li writing the present full state as a single line at the end of the file
+ *     \li writing the states saved in deferred mode
+ *     \li draining the shared log ring buffer.
+ *
+ *  The log file is opened once per process and kept open for its whole life; each line is
+ *  formatted in memory and appended with a single <tt>write</tt> (<tt>O_APPEND</tt>).
+ *
+ *  In binary format (<tt>LOG_BINARY</tt>) the file holds a LOG_HEADER followed by fixed size records:
+ *  the sequence number (4 bytes), the time stamp (8 bytes) and the state of every entity (1 byte each),
+ *  in host byte order. In delta format (<tt>LOG_DELTA</tt>) the records are DELTA_REC tuples, one per entity
+ *  whose state changed since the previous record. <tt>logDecode</tt> converts both back to the text layout.
  *
  *  \author Nuno Lau - December 2024
  */
@@ -15,8 +25,102 @@
 #ifndef LOGGING_H_
 #define LOGGING_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "probDataStruct.h"
 
+/** \brief length of a log line (one 4 char column per entity, two separators and the newline) */
+#define  LINE_LEN(nP,nG,nR)   (4 * ((nP) + (nG) + (nR)) + 3)
+
+/** \brief maximum length of the file header (title line, blank line and column names) */
+#define  HEADER_LEN(nP,nG,nR) (128 + 8 * ((nP) + (nG) + (nR)))
+
+/** \brief magic number at the start of a binary log file */
+#define  LOG_MAGIC          "SGBL"
+
+/** \brief magic number at the start of a delta log file */
+#define  LOG_MAGIC_DELTA    "SGDL"
+
+/** \brief version of the binary log format */
+#define  LOG_VERSION        1
+
+/** \brief length of a binary record before the entity states (sequence number and time stamp) */
+#define  LOG_REC_HDR        12
+
+/** \brief length of a binary record */
+#define  REC_LEN(nP,nG,nR)    (LOG_REC_HDR + (nP) + (nG) + (nR))
+
+/* entity types of a delta record */
+
+/** \brief state saved with no change (keeps one record per saved state) */
+#define  DELTA_NONE         0
+/** \brief the changed entity is a player */
+#define  DELTA_PLAYER       1
+/** \brief the changed entity is a goalie */
+#define  DELTA_GOALIE       2
+/** \brief the changed entity is a referee */
+#define  DELTA_REFEREE      3
+
+/** \brief maximum number of entities of a type in a delta log */
+#define  DELTA_ID_MAX       65536
+
+/**
+ *  \brief Definition of <em>delta log record</em> data type.
+ */
+typedef struct
+{   /** \brief sequence number of the saved state */
+    uint32_t seq;
+    /** \brief type of the entity (DELTA_NONE, DELTA_PLAYER, DELTA_GOALIE or DELTA_REFEREE) */
+    uint8_t type;
+    /** \brief new state of the entity */
+    uint8_t state;
+    /** \brief id of the entity within its type */
+    uint16_t id;
+
+} DELTA_REC;
+
+/**
+ *  \brief Definition of <em>binary log header</em> data type.
+ */
+typedef struct
+{   /** \brief LOG_MAGIC (not null terminated) */
+    char magic[4];
+    /** \brief LOG_VERSION */
+    uint32_t version;
+    /** \brief length of a record (in bytes) */
+    uint32_t recSize;
+    /** \brief number of players, goalies and referees (columns of a record) */
+    uint32_t nPlayers, nGoalies, nReferees;
+
+} LOG_HEADER;
+
+/**
+ *  \brief Format the text header (title line, blank line, column names).
+ *
+ *  \param buf buffer of at least HEADER_LEN bytes
+ *  \param size size of buf
+ *  \param nPlayers number of players
+ *  \param nGoalies number of goalies
+ *  \param nReferees number of referees
+ *
+ *  \return header length (in bytes)
+ */
+extern int logTextHeader (char *buf, size_t size, int nPlayers, int nGoalies, int nReferees);
+
+/**
+ *  \brief Format the state of all entities as a text line.
+ *
+ *  \param line buffer of at least LINE_LEN bytes
+ *  \param st state of all entities (players, goalies, referees)
+ *  \param nPlayers number of players
+ *  \param nGoalies number of goalies
+ *  \param nReferees number of referees
+ *
+ *  \return line length (in bytes)
+ */
+extern int logTextLine (char *line, ENTITY_STAT *st, int nPlayers, int nGoalies, int nReferees);
+
 /**
  *  \brief File initialization.
  *
@@ -28,6 +132,7 @@
  *       \li a blank line.
  *
  *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
  */
 extern void createLog (char nFic[], FULL_STAT *p_fSt);
 
@@ -35,10 +140,52 @@ extern void createLog (char nFic[], FULL_STAT *p_fSt);
  *  \brief write a log record (complete line) that includes the state of all entities and more info.
  *
  *  If <tt>nFic</tt> is a null pointer or a null string, the lines are written to stdout
+ *  The file is opened on the first call and the descriptor is reused by the following ones.
+ *
+ *  In deferred mode only a snapshot of the state is taken; the line is written by <tt>flushState</tt>.
+ *  In ring mode the snapshot is copied to the shared ring buffer and written by <tt>drainLog</tt>.
+ *  Must be called inside the critical region.
  *
  *  \param nFic name of the logging file
  *  \param p_fSt pointer to the location where the full internal state of the problem is stored
  */
 extern void saveState (char nFic[], FULL_STAT *p_fSt);
 
+/**
+ *  \brief write the log records saved in deferred mode by this process.
+ *
+ *  Must be called right after leaving each critical region that saved a state. Does nothing in direct and ring modes.
+ *
+ *  \param nFic name of the logging file
+ */
+extern void flushState (char nFic[]);
+
+/**
+ *  \brief set the shared log control block, which holds the logging mode and the ring buffer.
+ *
+ *  Without a control block the direct mode is used.
+ *
+ *  \param p_log pointer to the log control block in the shared memory region
+ */
+extern void attachLog (LOG_BUF *p_log);
+
+/**
+ *  \brief write the records published in the shared log ring buffer with a single write.
+ *
+ *  Only one process (the main program) may drain the ring.
+ *
+ *  \param nFic name of the logging file
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ *
+ *  \return number of records written
+ */
+extern int drainLog (char nFic[], FULL_STAT *p_fSt);
+
+/**
+ *  \brief wait for the writes of the drain still in flight (asynchronous sink, make LOG_SINK=uring).
+ *
+ *  Must be called by the process draining the ring after its last drainLog of a game.
+ */
+extern void syncLog (void);
+
 #endif /* LOGGING_H_ */
@@ -0,0 +1,104 @@
+/**
+ *  \file metrics.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Metrics of the batch of games.
+ *
+ *  Implementation of the interface defined in metrics.h.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdint.h>
+#include <time.h>
+#include <sched.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+#include "metrics.h"
+
+/** \brief attempts of a reading before giving up (a writer may have been killed during an update) */
+#define  METRIC_TRIES       1000
+
+/** \brief waits of the entity not yet published */
+static ENTITY_LOCAL uint64_t waits;
+
+/** \brief time of the waits of the entity not yet published (ns) */
+static ENTITY_LOCAL uint64_t waitNs;
+
+/** \brief start of an update of the block (single writer; seq stays odd if a writer was killed during an update,
+           the next update makes it even again) */
+static void writeBegin (METRICS *m)
+{
+    __atomic_store_n (&m->seq, (m->seq + 1) | 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence (__ATOMIC_RELEASE);                       /* seq is odd before the counters change */
+}
+
+/** \brief end of an update of the block */
+static void writeEnd (METRICS *m)
+{
+    __atomic_store_n (&m->seq, m->seq + 1, __ATOMIC_RELEASE);
+}
+
+/** \brief addition to a counter, inside an update */
+static void add (METRICS *m, int counter, uint64_t n)
+{
+    __atomic_store_n (&m->count[counter], m->count[counter] + n, __ATOMIC_RELAXED);
+}
+
+uint64_t metricsNow (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+void metricsAdd (SHARED_DATA *sh, int counter, uint64_t n)
+{
+    writeBegin (&sh->metrics);
+    add (&sh->metrics, counter, n);
+    writeEnd (&sh->metrics);
+}
+
+void metricsWait (uint64_t t0)
+{
+    waits++;
+    waitNs += metricsNow () - t0;
+}
+
+void metricsRegion (SHARED_DATA *sh, uint64_t ns)
+{
+    writeBegin (&sh->metrics);
+    add (&sh->metrics, METRIC_ENTRIES, 1);
+    add (&sh->metrics, METRIC_MUTEX_NS, ns);
+    if (ns > METRIC_CONTENDED_NS)
+       add (&sh->metrics, METRIC_CONTENDED, 1);
+    if (waits > 0) {
+       add (&sh->metrics, METRIC_WAITS, waits);
+       add (&sh->metrics, METRIC_WAIT_NS, waitNs);
+       waits = waitNs = 0;
+    }
+    writeEnd (&sh->metrics);
+}
+
+int metricsRead (const METRICS *m, uint64_t count[METRIC_NUM])
+{
+    unsigned int seq;
+    int tries, c;
+
+    for (tries = 0; tries < METRIC_TRIES; tries++) {
+        if ((seq = __atomic_load_n (&m->seq, __ATOMIC_ACQUIRE)) & 1) {              /* an update is in progress */
+           sched_yield ();
+           continue;
+        }
+        for (c = 0; c < METRIC_NUM; c++)
+          count[c] = __atomic_load_n (&m->count[c], __ATOMIC_RELAXED);
+        __atomic_thread_fence (__ATOMIC_ACQUIRE);                   /* the counters are read before seq again */
+        if (__atomic_load_n (&m->seq, __ATOMIC_RELAXED) == seq)
+           return 0;
+    }
+    return -1;
+}
@@ -0,0 +1,71 @@
+/**
+ *  \file metrics.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Metrics of the batch of games.
+ *
+ *  The metrics block of the shared region (see METRICS) is a seqlock updated inside the critical region, and
+ *  read by the observers without taking the mutex. The waits of an entity outside the critical region are
+ *  accumulated by the entity and published on its next entry in the critical region, so the entities do no
+ *  extra I/O and only touch the block while they already hold the mutex.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <stdint.h>
+
+#include "sharedDataSync.h"
+
+/**
+ *  \brief Present time (ns, CLOCK_MONOTONIC).
+ *
+ *  \return time
+ */
+extern uint64_t metricsNow (void);
+
+/**
+ *  \brief Addition to a counter of the metrics block.
+ *
+ *  The caller is in the critical region (or no entity is running).
+ *
+ *  \param sh pointer to the shared region
+ *  \param counter METRIC_GAMES .. METRIC_MUTEX_NS
+ *  \param n value added
+ */
+extern void metricsAdd (SHARED_DATA *sh, int counter, uint64_t n);
+
+/**
+ *  \brief End of a wait of the entity on a semaphore or a barrier, published on its next entry in the
+ *  critical region.
+ *
+ *  \param t0 time of the start of the wait (metricsNow)
+ */
+extern void metricsWait (uint64_t t0);
+
+/**
+ *  \brief Entry of the entity in the critical region.
+ *
+ *  Counts the entry and its wait for the mutex, and publishes the waits of the entity since its last entry.
+ *  The caller has just entered the critical region.
+ *
+ *  \param sh pointer to the shared region
+ *  \param waitNs time waited for the mutex (ns)
+ */
+extern void metricsRegion (SHARED_DATA *sh, uint64_t waitNs);
+
+/**
+ *  \brief Consistent reading of the metrics block, without taking the mutex.
+ *
+ *  \param m pointer to the metrics block
+ *  \param count pointer to the location where the METRIC_NUM counters are stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, if no consistent reading was possible (an update is in progress for too long)
+ */
+extern int metricsRead (const METRICS *m, uint64_t count[METRIC_NUM]);
+
+#endif /* METRICS_H_ */
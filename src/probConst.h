@@ -11,7 +11,7 @@
 #ifndef PROBCONST_H_
 #define PROBCONST_H_
 
-/* Generic parameters */
+/* Generic parameters (default values, they may be changed on the command line of probSemSharedMemSoccerGame) */
  
 /** \brief total number of players */
 #define  NUMPLAYERS       10
@@ -25,6 +25,61 @@
 /** \brief number of goalies in teach team */
 #define  NUMTEAMGOALIES     1
 
+/** \brief number of teams in a match */
+#define  NUMTEAMS           2
+
+
+/* Logging modes */
+
+/** \brief log line formatted and written inside the critical region */
+#define  LOG_DIRECT         0
+/** \brief state snapshot taken inside the critical region, line written after leaving it */
+#define  LOG_DEFERRED       1
+/** \brief state snapshot copied to a ring buffer in shared memory, drained to the file by the main process */
+#define  LOG_RING           2
+
+/* Log file formats */
+
+/** \brief one text line per record, a 4 char column per entity */
+#define  LOG_TEXT           0
+/** \brief binary header followed by fixed size records, a byte per entity (decoded by logDecode) */
+#define  LOG_BINARY         1
+/** \brief binary header followed by one record (seq, entity type, entity id, new state) per changed entity */
+#define  LOG_DELTA          2
+
+/** \brief number of slots of the shared log ring buffer (power of 2) */
+#define  LOG_RING_SIZE   1024
+
+
+/* Replay of the order of entry in the critical region */
+
+/** \brief the order of entry is neither recorded nor followed */
+#define  REPLAY_OFF         0
+/** \brief the entity entering the critical region is recorded on each entry */
+#define  REPLAY_RECORD      1
+/** \brief the entities enter the critical region in a recorded order */
+#define  REPLAY_FOLLOW      2
+
+/** \brief maximum number of entries recorded in a game */
+#define  REPLAY_MAX         (1 << 20)
+
+/** \brief time without any entry after which a replayed game is taken as diverged (ms) */
+#define  REPLAY_TIMEOUT     1000
+
+/** \brief time an entity waits before trying again when it is not its turn to enter (us) */
+#define  REPLAY_POLL        20
+
+/** \brief time a free player or goalie waits before checking again whether it was called, when the order of
+           entry is recorded or replayed (us) */
+#define  TEAM_POLL          1000
+
+/** \brief wait for the mutex above which an entry in the critical region counts as contended (ns): an
+           uncontended down does not block, a blocked one at least takes a context switch */
+#define  METRIC_CONTENDED_NS   4000
+
+/** \brief maximum length of the name of the trace file */
+#define  TRACE_NAME_LEN     256
+
 
 /* Player/Goalie state constants */
 
@@ -14,31 +14,60 @@
 #define PROBDATASTRUCT_H_
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
 
 #include "probConst.h"
+#include "barrier.h"
 
-/**
- *  \brief Definition of <em>state of the intervening entities</em> data type.
+/** \brief size of a cache line (in bytes) */
+#define  CACHE_LINE        64
+
+/** \brief start a member (or type) on a cache line of its own */
+#define  CACHE_ALIGNED     __attribute__ ((aligned (CACHE_LINE)))
+
+/** \brief storage of the per entity statics: one copy per thread when the entities are threads (thread engine) */
+#ifdef THREAD_ENGINE
+#define  ENTITY_LOCAL      __thread
+#else
+#define  ENTITY_LOCAL
+#endif
+
+#ifdef COMPACT_STAT
+/*
+ *  Compact layout (make LAYOUT=compact): one byte per entity state, and per-entity states, problem parameters
+ *  and counters updated on every transition are kept in separate cache lines.
  */
-typedef struct {
-    /** \brief players state */
-    unsigned int playerStat[NUMPLAYERS];
-    /** \brief goalies state */
-    unsigned int goalieStat[NUMGOALIES];
-    /** \brief referees state */
-    unsigned int refereeStat;
+/** \brief state of one entity (only holds a state constant) */
+typedef uint8_t ENTITY_STAT;
+/** \brief start a group of members of FULL_STAT on a new cache line */
+#define  STAT_GROUP        CACHE_ALIGNED
+#else
+/** \brief state of one entity (only holds a state constant) */
+typedef unsigned int ENTITY_STAT;
+/** \brief start a group of members of FULL_STAT on a new cache line */
+#define  STAT_GROUP
+#endif
+
+/** \brief size (in bytes) of the state of all intervening entities */
+#define  STAT_SIZE(nP,nG,nR)       ((size_t) ((nP) + (nG) + (nR)) * sizeof (ENTITY_STAT))
 
-} STAT;
+/** \brief state of player <tt>id</tt> */
+#define  PLAYER_STAT(p_fSt,id)     ((p_fSt)->st[(id)])
+/** \brief state of goalie <tt>id</tt> */
+#define  GOALIE_STAT(p_fSt,id)     ((p_fSt)->st[(p_fSt)->nPlayers + (id)])
+/** \brief state of referee <tt>id</tt> */
+#define  REFEREE_STAT(p_fSt,id)    ((p_fSt)->st[(p_fSt)->nPlayers + (p_fSt)->nGoalies + (id)])
 
 
 /**
  *  \brief Definition of <em>full state of the problem</em> data type.
+ *
+ *  The number of entities is only known at run time, so the state of the intervening entities is a flexible
+ *  array at the end: players state, goalies state and referees state.
  */
 typedef struct
-{   /** \brief state of all intervening entities */
-    STAT st;
-
-    /** \brief total number of players */
+{   /** \brief total number of players */
     int nPlayers;
 
     /** \brief total number of goalies */
@@ -47,19 +76,188 @@ typedef struct
     /** \brief total number of referees */
     int nReferees;
 
-    /** \brief number of players that already arrived */
-    int playersArrived;
-    /** \brief number of goalies that already arrived */
-    int goaliesArrived;
-    /** \brief number of players that arrived and are free (no team) */
-    int playersFree;
-    /** \brief number of goalies that arrived and are free (no team) */
-    int goaliesFree;
+    /** \brief number of players in each team */
+    int nTeamPlayers;
+
+    /** \brief number of goalies in each team */
+    int nTeamGoalies;
+
+    /** \brief tournament mode: teams are queued and matched to a free referee, players play until the end */
+    bool tournament;
+
+    /** \brief number of matches of the tournament (1 outside tournament mode) */
+    int nMatches;
+
+    /** \brief formation word: number of free players and goalies (arrived, no team) and number of teams formed,
+               updated by compare and swap (see FORM_PLAYERS, FORM_GOALIES and FORM_TEAMS) */
+    uint64_t formation STAT_GROUP;
+    /** \brief number of tickets taken by the players and by the goalies joining a team */
+    int playerTickets, goalieTickets;
+    /** \brief number of teams with all their members registered */
+    int teamsComplete;
+    /** \brief number of calls of the formers not yet taken by the free players and by the free goalies, when
+               the order of entry is recorded or replayed (the calls are then not semaphore ups) */
+    int playersCalled, goaliesCalled;
+
+    /** \brief number of complete teams waiting for a referee at the head of the queue (in the order of their ids) */
+    int teamsQueued;
 
-    /** \brief id of team that will be formed next - initial value=1 */
-    int teamId;
+    /** \brief state of all intervening entities (nPlayers + nGoalies + nReferees entries) */
+    ENTITY_STAT st[] STAT_GROUP;
 
 } FULL_STAT;
 
+/* Formation word */
+
+/** \brief number of bits of each counter of the formation word */
+#define  FORM_BITS          21
+/** \brief number of free players in formation word <tt>w</tt> */
+#define  FORM_PLAYERS(w)    ((int) ((w) & ((UINT64_C (1) << FORM_BITS) - 1)))
+/** \brief number of free goalies in formation word <tt>w</tt> */
+#define  FORM_GOALIES(w)    ((int) (((w) >> FORM_BITS) & ((UINT64_C (1) << FORM_BITS) - 1)))
+/** \brief number of teams formed in formation word <tt>w</tt> */
+#define  FORM_TEAMS(w)      ((int) ((w) >> (2 * FORM_BITS)))
+/** \brief one free player, one free goalie and one team formed, in a formation word */
+#define  FORM_PLAYER        UINT64_C (1)
+#define  FORM_GOALIE        (UINT64_C (1) << FORM_BITS)
+#define  FORM_TEAM          (UINT64_C (1) << (2 * FORM_BITS))
+
+/** \brief number of teams formed in a game */
+#define  MAX_TEAMS(st)      (NUMTEAMS * (st)->nMatches)
+
+/** \brief id of a team slot being claimed by the former of a team */
+#define  TEAM_CLAIMED       (-1)
+
+/** \brief entry of the queue of the formed teams for a team not complete yet */
+#define  TEAM_NOT_QUEUED    (-1)
+
+/**
+ *  \brief Definition of <em>team slot</em> data type.
+ *
+ *  Members are identified by their index in the entity state array: player id, or number of players plus
+ *  goalie id.
+ */
+typedef struct
+{   /** \brief id of the team (0 if the slot is free, TEAM_CLAIMED while the former initializes it) */
+    int id;
+    /** \brief referee of the match of the team (-1 while the team is waiting for a referee) */
+    int referee;
+    /** \brief number of members already registered */
+    int nMembers;
+    /** \brief rendezvous of the members and the referee at the start and at the end of the match */
+    BARRIER barrier;
+    /** \brief members of the team (nTeamPlayers + nTeamGoalies entries) */
+    int member[];
+
+} TEAM;
+
+/**
+ *  \brief Definition of <em>log ring slot</em> data type.
+ */
+typedef struct
+{   /** \brief sequence number of the stored record plus one (0 while the slot is being filled or empty) */
+    unsigned int seq;
+    /** \brief time of the snapshot (ns, CLOCK_MONOTONIC; binary format only) */
+    uint64_t ts;
+    /** \brief snapshot of the state of all intervening entities */
+    ENTITY_STAT st[];
+
+} LOG_SLOT;
+
+/**
+ *  \brief Definition of <em>log control block</em> data type.
+ *
+ *  Holds the logging mode and file format, the sequence number of the log records and, in ring mode, the location of the ring
+ *  buffer (LOG_RING_SIZE slots of <tt>stride</tt> bytes, <tt>slotOff</tt> bytes after the block).
+ *  In delta format the last logged state, <tt>lastOff</tt> bytes after the block, is compared with each new state.
+ *  Ring producers reserve a slot with an atomic fetch-and-add on <tt>seq</tt>, copy the snapshot and publish
+ *  it by storing its sequence number; the single consumer advances <tt>tail</tt>. A producer that finds its slot
+ *  still taken (the ring is full) blocks on the futex of <tt>tail</tt> until the consumer wakes it up.
+ */
+typedef struct
+{   /** \brief logging mode (LOG_DIRECT, LOG_DEFERRED or LOG_RING) */
+    int mode;
+    /** \brief format of the log file (LOG_TEXT, LOG_BINARY or LOG_DELTA) */
+    int format;
+    /** \brief sequence number of the next log record - initial value=0 */
+    unsigned int seq;
+    /** \brief number of delta records reserved so far (delta format) */
+    unsigned int nDelta;
+    /** \brief sequence number of the next record to be drained (ring mode) */
+    unsigned int tail CACHE_ALIGNED;
+    /** \brief number of producers blocked on a full ring (woken up by the consumer when it advances tail) */
+    unsigned int full;
+    /** \brief size of a ring slot (in bytes) */
+    unsigned int stride;
+    /** \brief offset of the first ring slot from the start of the block */
+    size_t slotOff;
+    /** \brief offset of the last logged state from the start of the block */
+    size_t lastOff;
+
+} LOG_BUF;
+
+/**
+ *  \brief Definition of <em>replay control block</em> data type.
+ *
+ *  Order of entry in the critical region: the entry log holds the entity (in the order of the entity states:
+ *  players, goalies, referees) of each entry, <tt>entryOff</tt> bytes after the start of the block.
+ *  On replay, an entity may only stay in the critical region when it is the next one in the log.
+ */
+typedef struct
+{   /** \brief replay mode (REPLAY_OFF, REPLAY_RECORD or REPLAY_FOLLOW) */
+    int mode;
+    /** \brief number of entries in the log */
+    unsigned int n;
+    /** \brief size of the log (in entries) */
+    unsigned int max;
+    /** \brief next entry to be followed (replay) */
+    unsigned int pos;
+    /** \brief entry at which the game diverged from the log (-1 if it did not) */
+    int diverged;
+    /** \brief time of the last entry followed (ns, CLOCK_MONOTONIC) */
+    uint64_t last;
+    /** \brief offset of the entry log from the start of the block */
+    size_t entryOff;
+
+} REPLAY;
+
+/* Counters of the metrics block */
+
+/** \brief games played to the end */
+#define  METRIC_GAMES             0
+/** \brief matches refereed to the end */
+#define  METRIC_MATCHES           1
+/** \brief teams formed */
+#define  METRIC_TEAMS             2
+/** \brief players and goalies that were late */
+#define  METRIC_LATE              3
+/** \brief waits on the semaphores and barriers (besides the mutex) */
+#define  METRIC_WAITS             4
+/** \brief time spent in those waits (ns) */
+#define  METRIC_WAIT_NS           5
+/** \brief entries in the critical region */
+#define  METRIC_ENTRIES           6
+/** \brief entries in the critical region that had to wait for the mutex (see METRIC_CONTENDED_NS) */
+#define  METRIC_CONTENDED         7
+/** \brief time spent waiting for the mutex (ns) */
+#define  METRIC_MUTEX_NS          8
+/** \brief number of counters */
+#define  METRIC_NUM               9
+
+/**
+ *  \brief Definition of <em>metrics block</em> data type.
+ *
+ *  Counters of the whole batch of games, for the observers (soccerstat), which read them without taking the
+ *  mutex. The block is a seqlock: the entities only update it inside the critical region (the main program,
+ *  between games), so there is a single writer at a time, which makes <tt>seq</tt> odd while it updates the
+ *  counters; a reader retries until it reads the same even <tt>seq</tt> before and after the counters.
+ */
+typedef struct
+{   /** \brief sequence number of the updates (odd while an update is in progress) */
+    unsigned int seq;
+    /** \brief counters (METRIC_NUM entries) */
+    uint64_t count[METRIC_NUM];
+
+} METRICS;
 
 #endif /* PROBDATASTRUCT_H_ */
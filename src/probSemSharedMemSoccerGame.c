@@ -11,14 +11,74 @@
  *  Upon execution, one parameter is requested:
  *    \li name of the logging file.
  *
+ *  Options:
+ *    \li <tt>-l direct|deferred|ring</tt> logging mode (default direct); in ring mode this program writes the log,
+ *        through io_uring when built with <tt>make LOG_SINK=uring</tt> (see logUring.h)
+ *    \li <tt>-f text|binary|delta</tt> format of the log file (default text, see logDecode)
+ *    \li <tt>-p n</tt> total number of players (default NUMPLAYERS)
+ *    \li <tt>-g n</tt> total number of goalies (default NUMGOALIES)
+ *    \li <tt>-P n</tt> number of players in each team (default NUMTEAMPLAYERS)
+ *    \li <tt>-G n</tt> number of goalies in each team (default NUMTEAMGOALIES)
+ *    \li <tt>-m n</tt> tournament mode with n matches: formed teams are queued and matched to a free referee,
+ *        and players and goalies keep forming teams until all matches have been assigned
+ *    \li <tt>-r n</tt> number of referees, running concurrent matches (default NUMREFEREES, tournament mode only)
+ *    \li <tt>-n n</tt>, <tt>--runs n</tt> batch mode: n games on the same shared region and semaphore set, the rate of
+ *        games per second is reported at the end (the log file holds the last game)
+ *    \li <tt>-j k</tt>, <tt>--parallel k</tt> the games of the batch are split among k processes running in
+ *        parallel, each with its own IPC key and log file (name suffixed with <tt>.0</tt>, <tt>.1</tt>, ...)
+ *    \li <tt>-d scale[:seed]</tt> simulated delays of the entities multiplied by scale (0 for no delays at all) and,
+ *        with a seed, taken from a deterministic schedule instead of the random generator
+ *    \li <tt>-s fork|spawn|zygote</tt> generation of the entities processes: fork and exec (default), posix_spawn
+ *        (vfork semantics, no copy of the parent address space), or fork only, running the entity code linked into
+ *        this program (no exec); the spawn latency of each entity type and the peak resident set size of the game
+ *        process and of its largest entity process are reported at the end (also in batch mode)
+ *    \li <tt>-S seed</tt> seed of the random generators of the main program and of every entity (each entity seeds
+ *        its generator with seed + 1 + its position in the entity states), and of the delay schedule when the
+ *        delay specification has none
+ *    \li <tt>--record file</tt> the order in which the entities enter the critical region is saved in file
+ *    \li <tt>--replay file</tt> the entities enter the critical region in the order saved in file by a previous game
+ *        with the same parameters; the entry at which the game diverged from it, if any, is reported at the end
+ *    \li <tt>--trace file</tt> the state transitions, semaphore operations and barrier waits of every entity are
+ *        saved in file, in the Chrome / Perfetto trace format (one track per entity)
+ *    \li <tt>--shm huge,prefault,lock</tt> (any of them) the shared region is backed by huge pages, its pages are
+ *        populated by the main program when it is created and by every entity when it attaches it (before its
+ *        first operation), and it is locked in memory
+ *    \li <tt>--affinity pack|spread</tt> every game process, with its entities and its shared region, is kept on one
+ *        NUMA node: the first one for all the games (pack), or game k on node k modulo the number of nodes (spread)
+ *    \li <tt>-w ms</tt>, <tt>--watchdog ms</tt> a game where no entity changes state for ms milliseconds (default
+ *        WATCHDOG_TIMEOUT, 0 for no watchdog) is stopped: the semaphore values and the entity states are dumped,
+ *        the entities are killed and the batch goes on with the next game; the program then exits with failure.
+ *        A game where an entity process fails (crash or exit with failure) is stopped in the same way.
+ *
+ *  Each game process takes the first free IPC key from <tt>ftok (".", 'a')</tt> up (at most KEY_RANGE keys), so
+ *  several programs may run at the same time in the same directory. The resources of a key left behind by a
+ *  crashed program (no process attached, creator gone) are reclaimed. They are released on exit, SIGINT and
+ *  SIGTERM, and the entities processes are killed if the program dies.
+ *
+ *  Built with THREAD_ENGINE defined (make thread), the program is the thread engine probThreadSoccerGame: the
+ *  entities are threads of the process, running the same life cycle code, and the semaphores and the shared region
+ *  are process-private (semaphoreThread.c and sharedMemoryThread.c). The only spawn mode is then <tt>thread</tt>.
+ *
  *  \author Nuno Lau - December 2024
  */
 
+#ifdef THREAD_ENGINE
+#define _GNU_SOURCE                                                                        /* pthread_timedjoin_np */
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <unistd.h>
+#include <getopt.h>
+#include <spawn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <signal.h>
 #include <sys/wait.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <string.h>
@@ -30,6 +90,12 @@
 #include "sharedDataSync.h"
 #include "semaphore.h"
 #include "sharedMemory.h"
+#include "delay.h"
+#include "replay.h"
+#include "barrier.h"
+#include "metrics.h"
+#include "trace.h"
+#include "affinity.h"
 
 /** \brief name of player program */
 #define   PLAYER               "./player"
@@ -40,109 +106,587 @@
 /** \brief name of referee program */
 #define   REFEREE              "./referee"
 
-void launch_processes(char *bin, char *prefix, int nProc, char *logFilename, int *pids)
+/** \brief default time without any change of state after which a game is stopped (ms) */
+#define   WATCHDOG_TIMEOUT     5000
+
+/** \brief period of the watchdog checks (ms) */
+#define   WATCHDOG_PERIOD      50
+
+/* Generation of the entities processes */
+
+/** \brief fork and exec the entity program */
+#define   SPAWN_FORK           0
+/** \brief posix_spawn of the entity program */
+#define   SPAWN_POSIX          1
+/** \brief fork and run the entity code linked into this program */
+#define   SPAWN_ZYGOTE         2
+/** \brief run the entity code linked into this program in a thread (thread engine) */
+#define   SPAWN_THREAD         3
+
+/* Long only options */
+
+/** \brief --record file */
+#define   OPT_RECORD           256
+/** \brief --replay file */
+#define   OPT_REPLAY           257
+/** \brief --trace file */
+#define   OPT_TRACE            258
+/** \brief --shm huge,prefault,lock */
+#define   OPT_SHM              259
+/** \brief --affinity pack|spread */
+#define   OPT_AFFINITY         260
+/** \brief --watchdog ms (-w) */
+#define   OPT_WATCHDOG         'w'
+
+/** \brief entry points of the entities linked into this program (zygote mode) */
+extern int playerMain (int argc, char *argv[]);
+extern int goalieMain (int argc, char *argv[]);
+extern int refereeMain (int argc, char *argv[]);
+
+extern char **environ;
+
+/**
+ *  \brief Definition of <em>spawn latency statistics</em> data type.
+ *
+ *  Time taken by the main program to generate each process of an entity type (in microseconds).
+ */
+typedef struct
+{   /** \brief number of processes generated */
+    unsigned long n;
+    /** \brief total and maximum latency */
+    double sum, max;
+
+} SPAWN_STAT;
+
+#ifdef THREAD_ENGINE
+/** \brief stack size of the entity threads */
+#define   THREAD_STACK         (256 * 1024)
+
+/**
+ *  \brief Definition of <em>entity thread</em> data type (thread engine).
+ *
+ *  Holds the thread and its command line, which must outlive the launch loop.
+ */
+typedef struct
+{   /** \brief thread identifier */
+    pthread_t tid;
+    /** \brief entry point of the entity */
+    int (*entry) (int, char *[]);
+    /** \brief command line arguments */
+    char id[12], key[12], errorFilename[128];
+    char *args[7];
+
+} ENTITY_THREAD;
+
+/** \brief threads of the entities of the present game */
+static ENTITY_THREAD *threads;
+
+/** \brief number of threads launched and number of threads that finished in the present game */
+static int nThreads, threadsDone;
+
+/** \brief attributes of the entity threads */
+static pthread_attr_t threadAttr;
+
+/** \brief life cycle of an entity thread */
+static void *entityThread (void *arg)
 {
-    char idstr[3];
+    ENTITY_THREAD *t = arg;
+
+    t->entry (6, t->args);
+    __atomic_fetch_add (&threadsDone, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+#endif
+
+/** \brief name of logging file */
+static char nFic[64];
+
+/** \brief delay specification passed to the entities */
+static char delaySpec[32] = "1";
+
+/** \brief seed of the random generators (0 if they are seeded by the pid) */
+static unsigned int seed = 0;
+
+/** \brief files where the order of entry in the critical region is recorded or from where it is replayed */
+static char *recordFile = NULL, *replayFile = NULL;
+
+/** \brief file where the events of the entities are traced (NULL if they are not) */
+static char *traceFile = NULL;
+
+/** \brief options of the shared region (SHMEM_HUGE, SHMEM_PREFAULT, SHMEM_LOCK) */
+static int shmOpts = 0;
+
+/** \brief placement of the games on the NUMA nodes (AFFINITY_NONE, AFFINITY_PACK, AFFINITY_SPREAD) */
+static int affinity = AFFINITY_NONE;
+
+/** \brief order of entry being replayed and its number of entries */
+static uint32_t *replayOrder = NULL;
+static unsigned int replayN = 0;
+
+/** \brief watchdog timeout (ms, 0 if there is no watchdog) */
+static int watchdog = WATCHDOG_TIMEOUT;
+
+/** \brief state of each entity at the last watchdog check and time it last changed (ms, CLOCK_MONOTONIC) */
+static ENTITY_STAT *watchSt;
+static double *watchTime;
+
+/** \brief simulation parameters, set from the command line */
+static int logMode = LOG_DIRECT,                                                                       /* logging mode */
+           logFormat = LOG_TEXT,                                                           /* format of the log file */
+           nPlayers = NUMPLAYERS,                                                             /* number of players */
+           nGoalies = NUMGOALIES,                                                             /* number of goalies */
+           nTeamPlayers = NUMTEAMPLAYERS,                                            /* number of players in a team */
+           nTeamGoalies = NUMTEAMGOALIES,                                            /* number of goalies in a team */
+           nReferees = NUMREFEREES,                                                           /* number of referees */
+           nMatches = 1,                                                                        /* number of matches */
+           nTeamSlots = NUMTEAMS;                                /* number of teams that may exist at the same time */
+static bool tournament = false;                                                                 /* tournament mode */
+#ifdef THREAD_ENGINE
+static int spawnMode = SPAWN_THREAD;                                          /* generation of the entities threads */
+#else
+static int spawnMode = SPAWN_FORK;                                           /* generation of the entities processes */
+#endif
+static bool spawnReport = false;                                                   /* report the spawn latencies */
+
+/** \brief spawn latencies of players, goalies and referees */
+static SPAWN_STAT spawnPL, spawnGL, spawnRF;
+
+/** \brief process identifier arrays of players, goalies and referees */
+static int *pidPL, *pidGL, *pidRF;
+
+/** \brief process that owns the IPC resources (0 if none) and their identifiers (-1 if not created) */
+static pid_t ipcOwner = 0;
+static int ipcShmid = -1, ipcSemgid = -1;
+
+/** \brief main process and its parallel game processes */
+static pid_t mainPid;
+static pid_t *pidGame;
+static int nGames;
+
+void launch_processes(char *bin, int (*entry) (int, char *[]), char *prefix, int nProc, char *logFilename, int key,
+                      int *pids, SPAWN_STAT *lat)
+{
+    char idstr[12];
+    char keystr[12];
     char errorFilename[128];
+    char *args[] = { bin, idstr, logFilename, errorFilename, keystr, delaySpec, NULL };
+    struct timespec t0, t1;
+    double t;
     int p;
+    sprintf(keystr,"%d", key);
+    fflush(NULL);                                                 /* do not duplicate buffered output in zygote mode */
     for (p = 0; p < nProc; p++) {           
-        if ((pids[p] = fork ()) < 0) {
-            perror ("error on the fork operation");
-            exit (EXIT_FAILURE);
-        }
         sprintf(idstr,"%d", p);
         sprintf(errorFilename,"error_%s%02d", prefix, p); 
-        if (pids[p] == 0)
-            if (execl (bin, bin, idstr, logFilename, errorFilename, NULL) < 0) { 
-                perror ("error on the generation of the process");
-                exit (EXIT_FAILURE);
+        clock_gettime (CLOCK_MONOTONIC, &t0);
+        switch (spawnMode) {
+            case SPAWN_POSIX:
+                if ((errno = posix_spawn (&pids[p], bin, NULL, NULL, args, environ)) != 0) {
+                    perror ("error on the generation of the process");
+                    exit (EXIT_FAILURE);
+                }
+                break;
+#ifdef THREAD_ENGINE
+            case SPAWN_THREAD: {
+                ENTITY_THREAD *th = &threads[nThreads++];
+                strcpy (th->id, idstr);
+                strcpy (th->key, keystr);
+                strcpy (th->errorFilename, errorFilename);
+                th->entry = entry;
+                th->args[0] = bin;
+                th->args[1] = th->id;
+                th->args[2] = logFilename;
+                th->args[3] = th->errorFilename;
+                th->args[4] = th->key;
+                th->args[5] = delaySpec;
+                th->args[6] = NULL;
+                if ((errno = pthread_create (&th->tid, &threadAttr, entityThread, th)) != 0) {
+                    perror ("error on the generation of the thread");
+                    exit (EXIT_FAILURE);
+                }
+                break;
             }
+#endif
+            default:
+                if ((pids[p] = fork ()) < 0) {
+                    perror ("error on the fork operation");
+                    exit (EXIT_FAILURE);
+                }
+                if (pids[p] == 0) {
+                    prctl (PR_SET_PDEATHSIG, SIGKILL);                         /* do not outlive a crashed parent */
+                    if (spawnMode == SPAWN_ZYGOTE)
+                        exit (entry (6, args));
+                    if (execl (bin, bin, idstr, logFilename, errorFilename, keystr, delaySpec, NULL) < 0) { 
+                        perror ("error on the generation of the process");
+                        exit (EXIT_FAILURE);
+                    }
+                }
+        }
+        clock_gettime (CLOCK_MONOTONIC, &t1);
+        t = (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3;
+        lat->n++;
+        lat->sum += t;
+        if (t > lat->max) lat->max = t;
+    }
+}
+
+/** \brief print the spawn latency statistics of one entity type */
+static void printSpawnStat (char *tag, char *name, SPAWN_STAT *lat)
+{
+    if (lat->n > 0) {
+        fprintf (stderr, "%sspawn latency %-8s %6lu processes  avg %8.1f us  max %8.1f us\n", tag, name, lat->n,
+                 lat->sum / lat->n, lat->max);
+    }
+}
+
+/** \brief print the peak resident set size of the game process and of its largest entity process */
+static void printPeakRss (char *tag)
+{
+    struct rusage self, children;
+
+    if ((getrusage (RUSAGE_SELF, &self) == -1) || (getrusage (RUSAGE_CHILDREN, &children) == -1)) {
+        return;
     }
+    fprintf (stderr, "%speak rss main %8ld kB  largest entity %8ld kB\n", tag, self.ru_maxrss,
+             children.ru_maxrss);                          /* with the thread engine, main holds all the entities */
+}
+
+/** \brief names of the first SEM_STAT_NUM semaphore locations */
+static void semNames (SHARED_DATA *sh, const char *name[SEM_STAT_NUM])
+{
+    memset (name, 0, SEM_STAT_NUM * sizeof (name[0]));
+    name[sh->mutex] = "mutex";
+    name[sh->playersWaitTeam] = "playersWaitTeam";
+    name[sh->goaliesWaitTeam] = "goaliesWaitTeam";
+    name[sh->refereeWaitTeams] = "refereeWaitTeams";
 }
 
+/** \brief print the latency statistics of the semaphores (only SEM_STATS builds keep them) */
+static void printSemStat (SHARED_DATA *sh, int semgid)
+{
+    const char *name[SEM_STAT_NUM];
+
+    semNames (sh, name);
+    semStatDump (semgid, name, SEM_STAT_NUM, stderr);
+}
+
+static double msNow (void)
+{
+    struct timespec t;
 
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+/** \brief start watching the entity states of a new game */
+static void watchStart (SHARED_DATA *sh)
+{
+    int e, nEnt = nPlayers + nGoalies + nReferees;
+    double t = msNow ();
+
+    memcpy (watchSt, sh->fSt.st, nEnt * sizeof (ENTITY_STAT));
+    for (e = 0; e < nEnt; e++) {
+        watchTime[e] = t;
+    }
+}
 
 /**
- *  \brief Main program.
+ *  \brief Watchdog check: the game is stalled when no entity changed state for the watchdog timeout.
  *
- *  Its role is starting the simulation by generating the intervening entities processes (players, goalies and referee)
- *  and waiting for their termination.
+ *  The states are read without entering the critical region, a torn read only delays the detection.
  */
-int main (int argc, char *argv[])
+static bool watchStalled (SHARED_DATA *sh)
 {
-    char nFic[51];                                                                              /*name of logging file */
-    int shmid,                                                                      /* shared memory access identifier */
-        semgid;                                                                     /* semaphore set access identifier */
-    unsigned int  m;                                                                             /* counting variables */
-    SHARED_DATA *sh;                                                                /* pointer to shared memory region */
-    int pidPL[NUMPLAYERS],                                                         /* players process identifier array */
-        pidGL[NUMGOALIES],                                                         /* goalies process identifier array */
-        pidRF;                                                                           /* referee process identifier */
-    int key;                                                           /*access key to shared memory and semaphore set */
-    int status,                                                                                    /* execution status */
-        info;                                                                                               /* info id */
+    int e, nEnt = nPlayers + nGoalies + nReferees;
+    double t = msNow (), last = 0;
 
-    /* getting log file name */
-    if(argc==2) {
-        strcpy(nFic, argv[1]);
+    for (e = 0; e < nEnt; e++) {
+        if (sh->fSt.st[e] != watchSt[e]) {
+            watchSt[e] = sh->fSt.st[e];
+            watchTime[e] = t;
+        }
+        if (watchTime[e] > last) last = watchTime[e];
     }
-    else strcpy(nFic, "");
+    return (watchdog > 0) && (t - last > watchdog);
+}
 
-    /* getting key value */
-    if ((key = ftok (".", 'a')) == -1) {
-        perror ("error on generating the key");
-        exit (EXIT_FAILURE);
+/** \brief dump the semaphore values, the barriers of the teams and the entity states of a stalled game */
+static void watchDump (SHARED_DATA *sh, int semgid, char *tag)
+{
+    static const char *type[] = { "players", "goalies", "referees" };
+    const int count[] = { nPlayers, nGoalies, nReferees };
+    const char *name[SEM_STAT_NUM];
+    unsigned int val[SEM_STAT_NUM];
+    int i, nSem, c, e = 0;
+    double t = msNow ();
+
+    fprintf (stderr, "%swatchdog: no entity changed state for %d ms, the game is stopped\n", tag, watchdog);
+    semNames (sh, name);
+    if ((nSem = semValues (semgid, val, SEM_STAT_NUM)) == -1) {
+        perror ("error on reading the semaphore values");
     }
+    for (i = 1; i < nSem; i++) {
+        if (i < SEM_STAT_NUM) {
+            fprintf (stderr, "%s  semaphore %-20s %u\n", tag, name[i], val[i]);
+        }
+        else {
+            fprintf (stderr, "%s  (%d more semaphores)\n", tag, nSem - SEM_STAT_NUM);
+            break;
+        }
+    }
+    for (i = 0; i < sh->nTeamSlots; i++) {
+        if (TEAM_SLOT (sh, i)->id > 0) {
+            fprintf (stderr, "%s  team slot %d: team %d, barrier %u of %u\n", tag, i, TEAM_SLOT (sh, i)->id,
+                     TEAM_SLOT (sh, i)->barrier.arrived, TEAM_SLOT (sh, i)->barrier.parties);
+        }
+    }
+    for (c = 0; c < 3; c++) {
+        fprintf (stderr, "%s  %-8s", tag, type[c]);
+        for (i = 0; i < count[c]; i++, e++) {
+            fprintf (stderr, " %c(%.0f)", sh->fSt.st[e], t - watchTime[e]);        /* state (ms in that state) */
+        }
+        fprintf (stderr, "\n");
+    }
+}
 
-    /* creating and initializing the shared memory region and the log file */
-    if ((shmid = shmemCreate (key, sizeof (SHARED_DATA))) == -1) { 
-        perror ("error on creating the shared memory region");
-        exit (EXIT_FAILURE);
+/** \brief kill the entities processes not yet waited for */
+static void killEntities (void)
+{
+    int p;
+
+    if (pidPL == NULL) return;
+
+    for (p = 0; p < nPlayers; p++)
+        if (pidPL[p] > 0) kill (pidPL[p], SIGKILL);
+    for (p = 0; p < nGoalies; p++)
+        if (pidGL[p] > 0) kill (pidGL[p], SIGKILL);
+    for (p = 0; p < nReferees; p++)
+        if (pidRF[p] > 0) kill (pidRF[p], SIGKILL);
+}
+
+/** \brief release the IPC resources, if created by this process (not by the parent of a zygote entity) */
+static void ipcRelease (void)
+{
+    if (ipcOwner == getpid ()) {
+        if (ipcSemgid != -1) semDestroy (ipcSemgid);
+        if (ipcShmid != -1) shmemDestroy (ipcShmid);
+        ipcSemgid = ipcShmid = -1;
     }
-    if (shmemAttach (shmid, (void **) &sh) == -1) { 
-        perror ("error on mapping the shared region on the process address space");
+}
+
+#ifndef THREAD_ENGINE
+/** \brief SIGINT or SIGTERM: the entities are killed, or the signal forwarded to the games, and the resources released */
+static void terminate (int sig)
+{
+    int k;
+
+    if (ipcOwner == getpid ()) {
+        killEntities ();
+        ipcRelease ();
+    }
+    else if (getpid () == mainPid) {
+        for (k = 0; k < nGames; k++) {
+            if (pidGame[k] > 0) kill (pidGame[k], SIGTERM);
+        }
+    }
+    signal (sig, SIG_DFL);
+    raise (sig);
+}
+#endif
+
+/** \brief forget an entity process that has been waited for */
+static void forgetEntity (int pid)
+{
+    int p;
+
+    for (p = 0; p < nPlayers; p++)
+        if (pidPL[p] == pid) { pidPL[p] = 0; return; }
+    for (p = 0; p < nGoalies; p++)
+        if (pidGL[p] == pid) { pidGL[p] = 0; return; }
+    for (p = 0; p < nReferees; p++)
+        if (pidRF[p] == pid) { pidRF[p] = 0; return; }
+}
+
+/** \brief save the recorded order of entry in the critical region, or report how the replayed one was followed */
+static void replayEnd (SHARED_DATA *sh, char *tag)
+{
+    REPLAY *r = &sh->replay;
+
+    if (r->mode == REPLAY_RECORD) {
+        if (replayWrite (recordFile, REPLAY_LOG (sh), r->n, nPlayers + nGoalies + nReferees) == -1) {
+            perror ("error on writing the order of entry in the critical region");
+            exit (EXIT_FAILURE);
+        }
+        if (r->n == r->max) {
+            fprintf (stderr, "%sorder of entry truncated to %u entries\n", tag, r->n);
+        }
+    }
+    else if (r->mode == REPLAY_FOLLOW) {
+        if (r->diverged != -1) {
+            fprintf (stderr, "%sreplay diverged at entry %d of %u\n", tag, r->diverged, r->n);
+        }
+        else if (r->pos < r->n) {
+            fprintf (stderr, "%sreplay ended at entry %u of %u\n", tag, r->pos, r->n);
+        }
+    }
+}
+
+/** \brief get the value of a numerical option, exiting when it is not an integer >= min */
+static int intOption (char *arg, int min, char *name)
+{
+    char *tinp;                                                                    /* numerical parameters test flag */
+    long val = strtol (arg, &tinp, 0);
+
+    if ((*tinp != '\0') || (val < min) || (val > 1000000)) {
+        fprintf (stderr, "Wrong value for the %s (%s)\n", name, arg);
         exit (EXIT_FAILURE);
     }
+    return (int) val;
+}
 
-    /* initialize random generator */
-    srandom ((unsigned int) getpid ());                                
+/** \brief get the options of the shared region from a comma separated list, exiting on an unknown one */
+static int shmOption (char *arg)
+{
+    int opts = 0;
+    char *opt;
+
+    for (opt = strtok (arg, ","); opt != NULL; opt = strtok (NULL, ",")) {
+        if (strcmp (opt, "huge") == 0) opts |= SHMEM_HUGE;
+        else if (strcmp (opt, "prefault") == 0) opts |= SHMEM_PREFAULT;
+        else if (strcmp (opt, "lock") == 0) opts |= SHMEM_LOCK;
+        else {
+            fprintf (stderr, "Unknown shared region option %s (huge,prefault,lock)\n", opt);
+            exit (EXIT_FAILURE);
+        }
+    }
+    return opts;
+}
+
+/**
+ *  \brief Initialization of the shared region for a new game.
+ *
+ *  Sets the problem internal status, the team slots and the log control block, and the semaphore ids.
+ *  It is called before each game, so a region created once may be reused by all games of a batch.
+ *
+ *  \param sh pointer to the shared region
+ *  \param size size of the shared region (in bytes)
+ */
+static void initSharedData (SHARED_DATA *sh, size_t size)
+{
+    int p, g, r, k;
 
     /* initialize problem internal status */
-    int p;
-    for (p = 0; p < NUMPLAYERS; p++) {
-        sh->fSt.st.playerStat[p]        = ARRIVING;                            /* the players are arriving */
+    sh->fSt.nPlayers         = nPlayers;                                              
+    sh->fSt.nGoalies         = nGoalies;
+    sh->fSt.nReferees        = nReferees;
+    sh->fSt.nTeamPlayers     = nTeamPlayers;
+    sh->fSt.nTeamGoalies     = nTeamGoalies;
+    sh->fSt.tournament       = tournament;
+    sh->fSt.nMatches         = nMatches;
+
+    for (p = 0; p < nPlayers; p++) {
+        PLAYER_STAT(&sh->fSt, p)        = ARRIVING;                            /* the players are arriving */
+    }
+    for (g = 0; g < nGoalies; g++) {
+        GOALIE_STAT(&sh->fSt, g)        = ARRIVING;                            /* the goalies are arriving */
     }
-    int g;
-    for (g = 0; g < NUMGOALIES; g++) {
-        sh->fSt.st.goalieStat[g]        = ARRIVING;                            /* the goalies are arriving */
+    for (r = 0; r < nReferees; r++) {
+        REFEREE_STAT(&sh->fSt, r)       = ARRIVINGR;                                 /* the referees are arriving */
     }
-    sh->fSt.st.refereeStat = ARRIVINGR;                                               /*referee is arriving*/
     
-    sh->fSt.nPlayers         = NUMPLAYERS;                                              
-    sh->fSt.nGoalies         = NUMGOALIES;
-    sh->fSt.playersArrived   = 0;                                             
-    sh->fSt.goaliesArrived   = 0;                                             
-    sh->fSt.playersFree      = 0;                                             
-    sh->fSt.goaliesFree      = 0;                                             
-    sh->fSt.teamId           = 1;                                             
+    sh->fSt.formation        = 0;                             /* no free players and goalies, no team formed */
+    sh->fSt.playerTickets    = 0;
+    sh->fSt.goalieTickets    = 0;
+    sh->fSt.teamsComplete    = 0;
+    sh->fSt.playersCalled    = 0;
+    sh->fSt.goaliesCalled    = 0;
+    sh->fSt.teamsQueued      = 0;
 
-    /* create log file */
-    createLog (nFic, &sh->fSt);                                  
-    saveState(nFic,&sh->fSt);
+    /* initialize team slots and queue */
+    sh->nTeamSlots           = nTeamSlots;
+    sh->queueHead            = 0;
+    sh->teamStride           = TEAM_SIZE (nTeamPlayers, nTeamGoalies);
+    sh->teamOff              = TEAM_OFFSET (nPlayers, nGoalies, nReferees);
+    sh->queueOff             = sh->teamOff + nTeamSlots * sh->teamStride;
+    memset (TEAM_SLOT (sh, 0), 0, nTeamSlots * (sh->teamStride + sizeof (int)));
+    for (k = 0; k < nTeamSlots; k++) {                   /* the members of the team and the referee of the match */
+        barrierInit (&TEAM_SLOT (sh, k)->barrier, nTeamPlayers + nTeamGoalies + 1);
+    }
+    for (k = 0; k < nTeamSlots; k++) {
+        TEAM_QUEUE (sh)[k]   = TEAM_NOT_QUEUED;                                         /* no team complete yet */
+    }
+
+    /* initialize log control block */
+    memset (&sh->log, 0, sizeof (sh->log));
+    sh->log.mode             = logMode;
+    sh->log.format           = logFormat;
+    sh->log.stride           = SLOT_SIZE (nPlayers, nGoalies, nReferees);
+    sh->log.slotOff          = RING_OFFSET (nPlayers, nGoalies, nReferees) - offsetof (SHARED_DATA, log);
+    sh->log.lastOff          = LAST_OFFSET (nPlayers, nGoalies, nReferees) - offsetof (SHARED_DATA, log);
+    memset ((char *) sh + RING_OFFSET (nPlayers, nGoalies, nReferees), 0, LOG_RING_SIZE * sh->log.stride);
+    memset ((char *) sh + LAST_OFFSET (nPlayers, nGoalies, nReferees), 0, STAT_SIZE (nPlayers, nGoalies, nReferees));
+    attachLog (&sh->log);
+    sh->layout               = SHARED_LAYOUT;
+    sh->size                 = size;
+    sh->shmem                = shmOpts;
+
+    /* initialize seed and order of entry in the critical region */
+    sh->seed                 = seed;
+    memset (&sh->replay, 0, sizeof (sh->replay));
+    sh->replay.diverged      = -1;
+    sh->replay.entryOff      = sh->queueOff + nTeamSlots * sizeof (int) - offsetof (SHARED_DATA, replay);
+    if (recordFile != NULL) {
+        sh->replay.mode      = REPLAY_RECORD;
+        sh->replay.max       = REPLAY_MAX;
+    }
+    else if (replayFile != NULL) {
+        sh->replay.mode      = REPLAY_FOLLOW;
+        sh->replay.max       = sh->replay.n = replayN;
+        memcpy (REPLAY_LOG (sh), replayOrder, replayN * sizeof (uint32_t));
+    }
+    strcpy (sh->trace, (traceFile != NULL) ? traceFile : "");
 
     /* initialize semaphore ids */
     sh->mutex                       = MUTEX;                                /* mutual exclusion semaphore id */
     sh->playersWaitTeam             = PLAYERSWAITTEAM;
     sh->goaliesWaitTeam             = GOALIESWAITTEAM;
-    sh->playersWaitReferee          = PLAYERSWAITREFEREE;
-    sh->playersWaitEnd              = PLAYERSWAITEND;
     sh->refereeWaitTeams            = REFEREEWAITTEAMS;
-    sh->playerRegistered            = PLAYERREGISTERED;
-    sh->playing                     = PLAYING;
- 
-     /* creating and initializing the semaphore set */
-    if ((semgid = semCreate (key, SEM_NU)) == -1) { 
-        perror ("error on creating the semaphore set");
+}
+
+/**
+ *  \brief Simulation of one game on an already created shared region and semaphore set.
+ *
+ *  The region and the semaphores are reinitialized, the intervening entities processes are generated and the
+ *  function waits for their termination, draining the log ring meanwhile.
+ *
+ *  \param sh pointer to the shared region
+ *  \param size size of the shared region (in bytes)
+ *  \param semgid semaphore set access identifier
+ *  \param key access key to shared memory and semaphore set, passed on to the entities
+ *  \param tag prefix of the error file names of the entities
+ *
+ *  \return true, if the game was stopped (by the watchdog or on the failure of an entity)
+ */
+static bool playGame (SHARED_DATA *sh, size_t size, int semgid, int key, char *tag)
+{
+    char prefix[16];                                                                      /* error file name prefix */
+    unsigned int m;                                                                              /* counting variable */
+    int status,                                                                                    /* execution status */
+        info;                                                                                               /* info id */
+    bool stopped = false;                               /* stopped by the watchdog or on an entity failure */
+    sigset_t child;                                                        /* termination of an entity process */
+    struct timespec period = { 0, WATCHDOG_PERIOD * 1000000L };
+
+    initSharedData (sh, size);
+
+    /* create log file */
+    createLog (nFic, &sh->fSt);                                  
+    saveState(nFic,&sh->fSt);
+    flushState(nFic);
+
+    /* initializing the semaphore set, all in red state but the mutex */
+    if (semReset (semgid) == -1) {
+        perror ("error on resetting the semaphore set");
         exit (EXIT_FAILURE);
     }
     if (semUp (semgid, sh->mutex) == -1) {                             /* enabling access to critical region */
@@ -152,33 +696,270 @@ int main (int argc, char *argv[])
 
     /* generation of intervening entities processes */                            
     /* player processes */
-    launch_processes(PLAYER, "PL", NUMPLAYERS, nFic, pidPL);
+    snprintf (prefix, sizeof (prefix), "%sPL", tag);
+    launch_processes(PLAYER, playerMain, prefix, nPlayers, nFic, key, pidPL, &spawnPL);
 
     /* goalie processes */
-    launch_processes(GOALIE, "GL", NUMGOALIES, nFic, pidGL);
+    snprintf (prefix, sizeof (prefix), "%sGL", tag);
+    launch_processes(GOALIE, goalieMain, prefix, nGoalies, nFic, key, pidGL, &spawnGL);
 
-    /* smoker processes */
-    launch_processes(REFEREE, "RF", 1, nFic, &pidRF);
+    /* referee processes */
+    snprintf (prefix, sizeof (prefix), "%sRF", tag);
+    launch_processes(REFEREE, refereeMain, prefix, nReferees, nFic, key, pidRF, &spawnRF);
 
 
     /* signaling start of operations */
+    sh->replay.last = 0;
+    if (sh->replay.mode == REPLAY_FOLLOW) {
+        struct timespec t;                                               /* the entities are waiting on the start */
+
+        clock_gettime (CLOCK_MONOTONIC, &t);
+        sh->replay.last = (uint64_t) t.tv_sec * 1000000000u + (uint64_t) t.tv_nsec;
+    }
     if (semSignal (semgid) == -1) {
         perror ("error on signaling start of operations");
         exit (EXIT_FAILURE);
     }
+    watchStart (sh);
+
+#ifdef THREAD_ENGINE
+    /* waiting for the termination of the intervening entities threads, draining the log ring meanwhile */
+    if (spawnMode == SPAWN_THREAD) {
+        while ((logMode == LOG_RING) && (__atomic_load_n (&threadsDone, __ATOMIC_ACQUIRE) < nThreads)) {
+            if (drainLog (nFic, &sh->fSt) == 0) {
+                usleep (100);                                                      /* nothing to drain, back off */
+            }
+            if (watchStalled (sh)) break;
+        }
+        for (m = 0; m < nThreads; m++) {
+            struct timespec limit;
+
+            do {
+                if (watchStalled (sh)) {                                 /* a blocked thread can not be killed */
+                    watchDump (sh, semgid, tag);
+                    exit (EXIT_FAILURE);
+                }
+                clock_gettime (CLOCK_REALTIME, &limit);
+                limit.tv_nsec += period.tv_nsec;
+                if (limit.tv_nsec >= 1000000000L) {
+                    limit.tv_sec++;
+                    limit.tv_nsec -= 1000000000L;
+                }
+            } while ((errno = pthread_timedjoin_np (threads[m].tid, NULL, &limit)) == ETIMEDOUT);
+            if (errno != 0) {
+                perror ("error on waiting for an intervening thread");
+                exit (EXIT_FAILURE);
+            }
+        }
+        nThreads = threadsDone = 0;
+        drainLog (nFic, &sh->fSt);
+        syncLog ();
+        replayEnd (sh, tag);
+        return false;
+    }
+#endif
 
-    /* waiting for the termination of the intervening entities processes */
+    /* waiting for the termination of the intervening entities processes, draining the log ring meanwhile;
+       with the watchdog, SIGCHLD is blocked and waited for with a timeout, to check the progress in between */
+    sigemptyset (&child);
+    sigaddset (&child, SIGCHLD);
+    if (watchdog > 0) {
+        sigprocmask (SIG_BLOCK, &child, NULL);
+    }
     m = 0;
     do {
-        info = wait (&status);
+        if ((logMode == LOG_RING) || (watchdog > 0)) {
+            info = waitpid (-1, &status, WNOHANG);
+            if (info == 0) {
+                if (!stopped && watchStalled (sh)) {
+                    watchDump (sh, semgid, tag);
+                    killEntities ();
+                    stopped = true;
+                }
+                if (logMode != LOG_RING) {
+                    sigtimedwait (&child, NULL, &period);
+                }
+                else if (drainLog (nFic, &sh->fSt) == 0) {
+                    usleep (100);                                                  /* nothing to drain, back off */
+                }
+                continue;
+            }
+        }
+        else info = wait (&status);
         if (info == -1) { 
             perror ("error on aiting for an intervening process");
             exit (EXIT_FAILURE);
         }
+        forgetEntity (info);
+        if (!stopped && (!WIFEXITED (status) || (WEXITSTATUS (status) != EXIT_SUCCESS))) {
+            if (WIFSIGNALED (status)) {
+                fprintf (stderr, "%sentity process %d killed by signal %d, the game is stopped\n", tag, info,
+                         WTERMSIG (status));
+            }
+            else fprintf (stderr, "%sentity process %d failed, the game is stopped\n", tag, info);
+            killEntities ();                                      /* the others would wait for it forever */
+            stopped = true;
+        }
         m += 1;
-    } while (m < 1 + NUMPLAYERS + NUMGOALIES);
+    } while (m < nReferees + nPlayers + nGoalies);
+    if (watchdog > 0) {
+        sigprocmask (SIG_UNBLOCK, &child, NULL);
+    }
+    drainLog (nFic, &sh->fSt);
+    syncLog ();
+    replayEnd (sh, tag);
+    return stopped;
+}
+
+/**
+ *  \brief Simulation of a batch of games sharing the same IPC resources.
+ *
+ *  The shared region and the semaphore set are created once, on the first free key from <tt>base</tt> up, used by
+ *  all the games and destroyed at the end.
+ *
+ *  \param nRuns number of games
+ *  \param game number of the game process (0 .. parallel games - 1), for its placement
+ *  \param base first access key to shared memory and semaphore set tried
+ *  \param tag prefix of the error file names of the entities
+ *
+ *  \return number of games stopped
+ */
+static int runGames (int nRuns, int game, int base, char *tag)
+{
+    int shmid,                                                                      /* shared memory access identifier */
+        semgid;                                                                     /* semaphore set access identifier */
+    SHARED_DATA *sh;                                                                /* pointer to shared memory region */
+    size_t shSize;                                                                          /* shared region size */
+    int key,                                                                 /* access key to the IPC resources */
+        reclaimed;                                                       /* stale resources found on the key */
+    int run, nStopped = 0,
+        node = 0;                                                     /* NUMA node of the game and its entities */
+
+    if (((pidPL = calloc (nPlayers, sizeof (int))) == NULL) || ((pidGL = calloc (nGoalies, sizeof (int))) == NULL) ||
+        ((pidRF = calloc (nReferees, sizeof (int))) == NULL)) {
+        perror ("error on allocating the process identifier arrays");
+        exit (EXIT_FAILURE);
+    }
+    if (((watchSt = malloc (STAT_SIZE (nPlayers, nGoalies, nReferees))) == NULL) ||
+        ((watchTime = malloc ((nPlayers + nGoalies + nReferees) * sizeof (double))) == NULL)) {
+        perror ("error on allocating the watchdog arrays");
+        exit (EXIT_FAILURE);
+    }
+#ifdef THREAD_ENGINE
+    if ((threads = malloc ((nPlayers + nGoalies + nReferees) * sizeof (ENTITY_THREAD))) == NULL) {
+        perror ("error on allocating the thread array");
+        exit (EXIT_FAILURE);
+    }
+    pthread_attr_init (&threadAttr);
+    pthread_attr_setstacksize (&threadAttr, THREAD_STACK);
+#endif
+
+    /* placing the game on its node, before anything is allocated or generated (the entities inherit it) */
+    if (affinity != AFFINITY_NONE) {
+        node = affinityNode (affinity, game);
+        if (affinitySet (node) == -1) {
+            perror ("error on placing the game on its node");
+            exit (EXIT_FAILURE);
+        }
+        if (spawnReport) {
+            fprintf (stderr, "%saffinity node %d of %d (cpus %s)\n", tag, node, affinityNodes (), affinityCpus (node));
+        }
+    }
+
+    /* creating the shared memory region and the semaphore set */
+    shSize = TEAM_OFFSET (nPlayers, nGoalies, nReferees) + nTeamSlots * (TEAM_SIZE (nTeamPlayers, nTeamGoalies) + sizeof (int));
+    if (recordFile != NULL) {
+        shSize += REPLAY_MAX * sizeof (uint32_t);                                      /* log of the recorded order */
+    }
+    else if (replayFile != NULL) {
+        shSize += replayN * sizeof (uint32_t);
+    }
+    shmemOptions (shmOpts);
+    for (key = base; ; key++) {
+        if (key == base + KEY_RANGE) {
+            fprintf (stderr, "No free IPC key (the %d keys from 0x%x are in use)\n", KEY_RANGE, base);
+            exit (EXIT_FAILURE);
+        }
+        if ((reclaimed = shmemReclaim (key)) == -1) {
+            if (errno == EBUSY) continue;                                        /* used by a running program */
+            perror ("error on reclaiming a stale shared memory region");
+            exit (EXIT_FAILURE);
+        }
+        if ((shmid = shmemCreate (key, shSize)) == -1) {
+            if (errno == EEXIST) continue;                                   /* taken by another program meanwhile */
+            bool noHuge = (shmOpts & SHMEM_HUGE) && (errno == ENOMEM);
+
+            perror ("error on creating the shared memory region");
+            if (noHuge) {
+                fprintf (stderr, "(are there huge pages reserved in /proc/sys/vm/nr_hugepages?)\n");
+            }
+            exit (EXIT_FAILURE);
+        }
+        break;
+    }
+    ipcOwner = getpid ();
+    ipcShmid = shmid;
+    if (shmemAttach (shmid, (void **) &sh) == -1) { 
+        perror ("error on mapping the shared region on the process address space");
+        exit (EXIT_FAILURE);
+    }
+    if ((affinity != AFFINITY_NONE) && (affinityBind (sh, shSize, node) == -1)) {
+        perror ("error on binding the shared region to the node of the game");
+        exit (EXIT_FAILURE);
+    }
+    switch (semReclaim (key)) {                                 /* the key is ours, a set on it was left behind */
+        case -1:
+            perror ("error on reclaiming a stale semaphore set");
+            exit (EXIT_FAILURE);
+        case 1:
+            reclaimed = 1;
+    }
+    if (reclaimed == 1) {
+        fprintf (stderr, "%sreclaimed the stale IPC resources of key 0x%x\n", tag, key);
+    }
+    if ((semgid = semCreate (key, SEM_NU)) == -1) { 
+        perror ("error on creating the semaphore set");
+        exit (EXIT_FAILURE);
+    }
+    ipcSemgid = semgid;
+    memset (&sh->metrics, 0, sizeof (sh->metrics));                  /* the metrics are kept from game to game */
+
+    /* initialize random generator */
+    srandom ((seed != 0) ? seed : (unsigned int) getpid ());
+
+    if (traceFile != NULL) {
+        traceDiscard (traceFile, nPlayers + nGoalies + nReferees);          /* left by an interrupted program */
+    }
+    for (run = 0; run < nRuns; run++) {
+        if (playGame (sh, shSize, semgid, key, tag)) {
+            nStopped++;                   /* the region and the semaphores are reinitialized for the next game */
+        }
+        else {
+            metricsAdd (sh, METRIC_GAMES, 1);                                       /* no entity is running */
+        }
+    }
+    if (nStopped > 0) {
+        fprintf (stderr, "%s%d of %d games stopped\n", tag, nStopped, nRuns);
+    }
+    if (spawnReport) {
+        printSpawnStat (tag, "players", &spawnPL);
+        printSpawnStat (tag, "goalies", &spawnGL);
+        printSpawnStat (tag, "referees", &spawnRF);
+        printPeakRss (tag);
+    }
+
+    printSemStat (sh, semgid);
+    if (traceFile != NULL) {
+        const char *name[SEM_STAT_NUM];
+
+        semNames (sh, name);
+        if (traceMerge (traceFile, &sh->fSt, name, SEM_STAT_NUM) == -1) {
+            perror ("error on writing the trace");
+        }
+    }
 
     /* destruction of semaphore set and shared region */
+    ipcSemgid = ipcShmid = -1;
     if (semDestroy (semgid) == -1) {
         perror ("error on destructing the semaphore set");
         exit (EXIT_FAILURE);
@@ -191,6 +972,280 @@ int main (int argc, char *argv[])
         perror ("error on destructing the shared region");
         exit (EXIT_FAILURE);
     }
+    return nStopped;
+}
+
+/**
+ *  \brief Main program.
+ *
+ *  Its role is starting the simulation by generating the intervening entities processes (players, goalies and referee)
+ *  and waiting for their termination.
+ */
+int main (int argc, char *argv[])
+{
+    int key;                                                           /*access key to shared memory and semaphore set */
+    int nRuns = 1,                                                                              /* number of games */
+        nParallel = 1;                                                         /* number of games run in parallel */
+    bool batch = false;                                                                   /* report the run rate */
+    struct timespec t0, t1;                                                                 /* start and end times */
+    double elapsed;
+    char baseFic[sizeof (nFic) - 12];                                          /* log file name given by the user */
+    char tag[16];                                                                         /* error file name prefix */
+    int status, k,
+        failed = 0;                                         /* games stopped by the watchdog or failed processes */
+    unsigned int nEntities;                                             /* number of entities of the replayed game */
+    char *tinp;                                                                    /* numerical parameters test flag */
+    int opt;
+
+    static struct option longOpts[] = {{ "runs", required_argument, NULL, 'n' },
+                                       { "parallel", required_argument, NULL, 'j' },
+                                       { "record", required_argument, NULL, OPT_RECORD },
+                                       { "replay", required_argument, NULL, OPT_REPLAY },
+                                       { "trace", required_argument, NULL, OPT_TRACE },
+                                       { "shm", required_argument, NULL, OPT_SHM },
+                                       { "affinity", required_argument, NULL, OPT_AFFINITY },
+                                       { "watchdog", required_argument, NULL, OPT_WATCHDOG },
+                                       { NULL, 0, NULL, 0 }};
+
+    /* getting options */
+    while ((opt = getopt_long (argc, argv, "l:f:p:g:P:G:m:r:n:j:d:s:S:w:", longOpts, NULL)) != -1) {
+        switch (opt) {
+            case 'l':
+                if (strcmp (optarg, "direct") == 0) logMode = LOG_DIRECT;
+                else if (strcmp (optarg, "deferred") == 0) logMode = LOG_DEFERRED;
+                else if (strcmp (optarg, "ring") == 0) logMode = LOG_RING;
+                else {
+                    fprintf (stderr, "Unknown logging mode %s (direct|deferred|ring)\n", optarg);
+                    exit (EXIT_FAILURE);
+                }
+                break;
+            case 'f':
+                if (strcmp (optarg, "text") == 0) logFormat = LOG_TEXT;
+                else if (strcmp (optarg, "binary") == 0) logFormat = LOG_BINARY;
+                else if (strcmp (optarg, "delta") == 0) logFormat = LOG_DELTA;
+                else {
+                    fprintf (stderr, "Unknown log format %s (text|binary|delta)\n", optarg);
+                    exit (EXIT_FAILURE);
+                }
+                break;
+            case 'p':
+                nPlayers = intOption (optarg, 1, "number of players");
+                break;
+            case 'g':
+                nGoalies = intOption (optarg, 1, "number of goalies");
+                break;
+            case 'P':
+                nTeamPlayers = intOption (optarg, 1, "number of players in a team");
+                break;
+            case 'G':
+                nTeamGoalies = intOption (optarg, 1, "number of goalies in a team");
+                break;
+            case 'm':
+                nMatches = intOption (optarg, 1, "number of matches");
+                tournament = true;
+                break;
+            case 'r':
+                nReferees = intOption (optarg, 1, "number of referees");
+                break;
+            case 'n':
+                nRuns = intOption (optarg, 1, "number of runs");
+                batch = true;
+                break;
+            case 'j':
+                nParallel = intOption (optarg, 1, "number of parallel games");
+                batch = true;
+                break;
+            case 'd':
+                if ((strlen (optarg) >= sizeof (delaySpec)) || (delayCheck (optarg) == -1)) {
+                    fprintf (stderr, "Wrong delay specification %s (scale[:seed])\n", optarg);
+                    exit (EXIT_FAILURE);
+                }
+                strcpy (delaySpec, optarg);
+                break;
+            case 's':
+#ifdef THREAD_ENGINE
+                if (strcmp (optarg, "thread") == 0) spawnMode = SPAWN_THREAD;
+                else {
+                    fprintf (stderr, "Unknown spawn mode %s (the thread engine only runs threads)\n", optarg);
+                    exit (EXIT_FAILURE);
+                }
+#else
+                if (strcmp (optarg, "fork") == 0) spawnMode = SPAWN_FORK;
+                else if (strcmp (optarg, "spawn") == 0) spawnMode = SPAWN_POSIX;
+                else if (strcmp (optarg, "zygote") == 0) spawnMode = SPAWN_ZYGOTE;
+                else {
+                    fprintf (stderr, "Unknown spawn mode %s (fork|spawn|zygote)\n", optarg);
+                    exit (EXIT_FAILURE);
+                }
+#endif
+                spawnReport = true;
+                break;
+            case 'S':
+                seed = (unsigned int) strtoul (optarg, &tinp, 0);
+                if ((*tinp != '\0') || (seed == 0)) {
+                    fprintf (stderr, "Wrong value for the seed (%s)\n", optarg);
+                    exit (EXIT_FAILURE);
+                }
+                break;
+            case OPT_RECORD:
+                recordFile = optarg;
+                break;
+            case OPT_REPLAY:
+                replayFile = optarg;
+                break;
+            case OPT_TRACE:
+                if (strlen (optarg) >= TRACE_NAME_LEN) {
+                    fprintf (stderr, "The name of the trace file is too long (at most %d characters)\n",
+                             TRACE_NAME_LEN - 1);
+                    exit (EXIT_FAILURE);
+                }
+                traceFile = optarg;
+                break;
+            case OPT_SHM:
+                shmOpts = shmOption (optarg);
+                break;
+            case OPT_AFFINITY:
+                if (strcmp (optarg, "pack") == 0) affinity = AFFINITY_PACK;
+                else if (strcmp (optarg, "spread") == 0) affinity = AFFINITY_SPREAD;
+                else {
+                    fprintf (stderr, "Unknown affinity policy %s (pack|spread)\n", optarg);
+                    exit (EXIT_FAILURE);
+                }
+                break;
+            case OPT_WATCHDOG:
+                watchdog = intOption (optarg, 0, "watchdog timeout");
+                break;
+            default:
+                fprintf (stderr, "Usage: %s [-l direct|deferred|ring] [-f text|binary|delta] [-p players] [-g goalies] [-P team players] "
+                                 "[-G team goalies] [-m matches] [-r referees] [--runs|-n runs] "
+                                 "[--parallel|-j games] [-d scale[:seed]] [-s fork|spawn|zygote] [-S seed] "
+                                 "[--record|--replay file] [--trace file] [--shm huge,prefault,lock] "
+                                 "[--affinity pack|spread] [--watchdog|-w ms] [logfile]\n", argv[0]);
+                exit (EXIT_FAILURE);
+        }
+    }
+    if ((nPlayers < NUMTEAMS * nTeamPlayers) || (nGoalies < NUMTEAMS * nTeamGoalies)) {
+        fprintf (stderr, "Not enough players and goalies to form %d teams of %d players and %d goalies\n",
+                 NUMTEAMS, nTeamPlayers, nTeamGoalies);
+        exit (EXIT_FAILURE);
+    }
+    if (!tournament && (nReferees != 1)) {
+        fprintf (stderr, "Several referees are only supported in tournament mode (-m)\n");
+        exit (EXIT_FAILURE);
+    }
+    if ((logFormat == LOG_DELTA) && ((nPlayers > DELTA_ID_MAX) || (nGoalies > DELTA_ID_MAX) || (nReferees > DELTA_ID_MAX))) {
+        fprintf (stderr, "At most %d entities of each type in a delta log\n", DELTA_ID_MAX);
+        exit (EXIT_FAILURE);
+    }
+    if (tournament) {                        /* every team holds nTeamPlayers players and nTeamGoalies goalies */
+        nTeamSlots = (nPlayers / nTeamPlayers < nGoalies / nTeamGoalies) ? nPlayers / nTeamPlayers
+                                                                          : nGoalies / nTeamGoalies;
+    }
+    if (nParallel > nRuns) {
+        nParallel = nRuns;
+    }
+    spawnReport = spawnReport || batch;
+    if ((seed != 0) && (strchr (delaySpec, ':') == NULL)) {                 /* the seed also fixes the delays */
+        snprintf (delaySpec + strlen (delaySpec), sizeof (delaySpec) - strlen (delaySpec), ":%u", seed);
+    }
+    if ((recordFile != NULL) && (replayFile != NULL)) {
+        fprintf (stderr, "The order of entry is either recorded or replayed\n");
+        exit (EXIT_FAILURE);
+    }
+    if (((recordFile != NULL) || (replayFile != NULL)) && (nParallel > 1)) {
+        fprintf (stderr, "Parallel games can not record or replay the order of entry\n");
+        exit (EXIT_FAILURE);
+    }
+    if ((traceFile != NULL) && (nParallel > 1)) {
+        fprintf (stderr, "Parallel games can not be traced\n");
+        exit (EXIT_FAILURE);
+    }
+    if (replayFile != NULL) {
+        if ((replayOrder = replayRead (replayFile, &replayN, &nEntities)) == NULL) {
+            perror ("error on reading the order of entry in the critical region");
+            exit (EXIT_FAILURE);
+        }
+        if (nEntities != nPlayers + nGoalies + nReferees) {
+            fprintf (stderr, "The order of entry in %s was recorded with %u entities\n", replayFile, nEntities);
+            exit (EXIT_FAILURE);
+        }
+    }
+
+    /* getting log file name */
+    if(argc==optind+1) {
+        strncpy(baseFic, argv[optind], sizeof(baseFic)-1);
+        baseFic[sizeof(baseFic)-1] = '\0';
+    }
+    else strcpy(baseFic, "");
+    if ((nParallel > 1) && (baseFic[0] == '\0')) {
+        fprintf (stderr, "Parallel games need a log file name (one log file per game)\n");
+        exit (EXIT_FAILURE);
+    }
+
+    /* getting key value */
+    if ((key = ftok (".", 'a')) == -1) {
+        perror ("error on generating the key");
+        exit (EXIT_FAILURE);
+    }
+
+    /* releasing the IPC resources on exit and on termination signals */
+    mainPid = getpid ();
+    atexit (ipcRelease);
+#ifndef THREAD_ENGINE
+    {
+        struct sigaction sa;
+
+        memset (&sa, 0, sizeof (sa));
+        sa.sa_handler = terminate;
+        sigaction (SIGINT, &sa, NULL);
+        sigaction (SIGTERM, &sa, NULL);
+    }
+#endif
+
+    clock_gettime (CLOCK_MONOTONIC, &t0);
+    if (nParallel == 1) {
+        strcpy (nFic, baseFic);
+        failed = runGames (nRuns, 0, key, "");
+    }
+    else {
+        /* one process per parallel game, each with its own key, log file and error files */
+        if ((pidGame = calloc (nParallel, sizeof (pid_t))) == NULL) {
+            perror ("error on allocating the game process identifier array");
+            exit (EXIT_FAILURE);
+        }
+        fflush (stdout);
+        for (k = 0; k < nParallel; k++) {
+            switch (pidGame[nGames++] = fork ()) {
+                case -1:
+                    perror ("error on the fork operation");
+                    exit (EXIT_FAILURE);
+                case 0:
+                    snprintf (nFic, sizeof (nFic), "%s.%d", baseFic, k);
+                    snprintf (tag, sizeof (tag), "%d_", k);
+                    exit ((runGames (nRuns / nParallel + (k < nRuns % nParallel), k, key + k, tag) == 0) ? EXIT_SUCCESS
+                                                                                                      : EXIT_FAILURE);
+            }
+        }
+        for (k = 0; k < nParallel; k++) {
+            if (wait (&status) == -1) {
+                perror ("error on waiting for a game process");
+                exit (EXIT_FAILURE);
+            }
+            if (!WIFEXITED (status) || (WEXITSTATUS (status) != EXIT_SUCCESS)) {
+                failed++;                                             /* the other games go on */
+            }
+        }
+    }
+    clock_gettime (CLOCK_MONOTONIC, &t1);
+
+    if (batch) {
+        elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+        fprintf (stderr, "%d runs (%d in parallel, %s semaphores) in %.3f s: %.1f runs/s, %.1f matches/s\n", nRuns,
+                 nParallel, semBackend (), elapsed, nRuns / elapsed, nRuns * (double) nMatches / elapsed);
+    }
+    if ((nParallel > 1) && (failed > 0)) {
+        fprintf (stderr, "%d parallel game processes failed\n", failed);
+    }
 
-    return EXIT_SUCCESS;
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,147 @@
+/**
+ *  \file replay.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Record and replay of the order of entry in the critical region.
+ *
+ *  All decisions of the entities are taken inside the critical region, so the order of entry determines the
+ *  game; the simulated delays and the wake up order of the semaphores only change the timing, unless several
+ *  entities wait on the same semaphore and the one woken up is not the recorded one, in which case the game
+ *  diverges and is finished in free order.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+#include "semaphore.h"
+#include "replay.h"
+#include "metrics.h"
+
+/** \brief magic number at the start of an order file */
+#define  REPLAY_MAGIC   "SGMO"
+
+/** \brief header of an order file */
+typedef struct {
+    char magic[4];
+    uint32_t nEntities;
+    uint32_t n;
+} REPLAY_HEADER;
+
+static uint64_t now (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000u + (uint64_t) t.tv_nsec;
+}
+
+/**
+ *  \brief Entry in the critical region, <em>down</em> of the mutex.
+ *
+ *  On replay the entity leaves the critical region and tries again after REPLAY_POLL us while it is not the next
+ *  one in the recorded order.
+ */
+int regionEnter (int semgid, SHARED_DATA *sh, int entity)
+{
+    REPLAY *r = &sh->replay;
+    uint64_t t0 = now ();
+
+    for (;;) {
+        if (semDown (semgid, sh->mutex) == -1) {
+            return -1;
+        }
+        switch (r->mode) {
+            case REPLAY_RECORD:
+                if (r->n < r->max) {
+                    REPLAY_LOG (sh)[r->n++] = entity;
+                }
+                break;
+            case REPLAY_FOLLOW:
+                if ((r->diverged != -1) || (r->pos == r->n)) {
+                    break;
+                }
+                if (REPLAY_LOG (sh)[r->pos] == entity) {
+                    r->pos++;
+                    r->last = now ();
+                    break;
+                }
+                if (now () - r->last > REPLAY_TIMEOUT * 1000000ull) {
+                    r->diverged = r->pos;                             /* the next entity will never come */
+                    break;
+                }
+                if (semUp (semgid, sh->mutex) == -1) {
+                    return -1;
+                }
+                usleep (REPLAY_POLL);                                               /* not its turn yet */
+                continue;
+        }
+        metricsRegion (sh, now () - t0);                     /* the wait includes the turns given on replay */
+        return 0;
+    }
+}
+
+/**
+ *  \brief Read an order of entry from a file.
+ */
+uint32_t *replayRead (const char *name, unsigned int *p_n, unsigned int *p_nEntities)
+{
+    REPLAY_HEADER hdr;
+    uint32_t *entry;
+    FILE *fp;
+
+    if ((fp = fopen (name, "r")) == NULL) {
+        return NULL;
+    }
+    if ((fread (&hdr, sizeof (hdr), 1, fp) != 1) || (memcmp (hdr.magic, REPLAY_MAGIC, sizeof (hdr.magic)) != 0) ||
+        (hdr.n > REPLAY_MAX)) {
+        fclose (fp);
+        errno = EINVAL;
+        return NULL;
+    }
+    if ((entry = malloc ((hdr.n + 1) * sizeof (uint32_t))) == NULL) {
+        fclose (fp);
+        return NULL;
+    }
+    if (fread (entry, sizeof (uint32_t), hdr.n, fp) != hdr.n) {
+        free (entry);
+        fclose (fp);
+        errno = EINVAL;
+        return NULL;
+    }
+    fclose (fp);
+    *p_n = hdr.n;
+    *p_nEntities = hdr.nEntities;
+    return entry;
+}
+
+/**
+ *  \brief Write an order of entry to a file.
+ */
+int replayWrite (const char *name, uint32_t *entry, unsigned int n, unsigned int nEntities)
+{
+    REPLAY_HEADER hdr;
+    FILE *fp;
+
+    memcpy (hdr.magic, REPLAY_MAGIC, sizeof (hdr.magic));
+    hdr.nEntities = nEntities;
+    hdr.n = n;
+    if ((fp = fopen (name, "w")) == NULL) {
+        return -1;
+    }
+    if ((fwrite (&hdr, sizeof (hdr), 1, fp) != 1) || (fwrite (entry, sizeof (uint32_t), n, fp) != n)) {
+        fclose (fp);
+        return -1;
+    }
+    return fclose (fp);
+}
@@ -0,0 +1,74 @@
+/**
+ *  \file replay.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Record and replay of the order of entry in the critical region.
+ *
+ *  The intervening entities enter the critical region with <tt>regionEnter</tt>, which, according to the mode
+ *  of the replay control block in the shared region:
+ *     \li records the entity on each entry (REPLAY_RECORD)
+ *     \li only lets the entity stay in the critical region when it is the next one in the recorded order,
+ *         otherwise it leaves it and tries again later (REPLAY_FOLLOW); once the order is exhausted, or when
+ *         no entity entered for REPLAY_TIMEOUT ms (the game diverged), the entities enter freely.
+ *
+ *  The order is saved in a file: a header (<tt>"SGMO"</tt>, number of entities, number of entries) followed by one
+ *  32 bit entity number per entry, in host byte order.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <stdint.h>
+
+#include "sharedDataSync.h"
+
+/** \brief entity number of player <tt>id</tt> (the order of the entity states) */
+#define  PLAYER_ENTITY(sh,id)    (id)
+
+/** \brief entity number of goalie <tt>id</tt> */
+#define  GOALIE_ENTITY(sh,id)    ((sh)->fSt.nPlayers + (id))
+
+/** \brief entity number of referee <tt>id</tt> */
+#define  REFEREE_ENTITY(sh,id)   ((sh)->fSt.nPlayers + (sh)->fSt.nGoalies + (id))
+
+/**
+ *  \brief Entry in the critical region, <em>down</em> of the mutex.
+ *
+ *  \param semgid set identifier
+ *  \param sh pointer to the shared region
+ *  \param entity entity number
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int regionEnter (int semgid, SHARED_DATA *sh, int entity);
+
+/**
+ *  \brief Read an order of entry from a file.
+ *
+ *  \param name name of the file
+ *  \param p_n pointer to the location where the number of entries is stored
+ *  \param p_nEntities pointer to the location where the number of entities of the recorded game is stored
+ *
+ *  \return the entries (allocated with malloc), upon success
+ *  \return NULL, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern uint32_t *replayRead (const char *name, unsigned int *p_n, unsigned int *p_nEntities);
+
+/**
+ *  \brief Write an order of entry to a file.
+ *
+ *  \param name name of the file
+ *  \param entry entries
+ *  \param n number of entries
+ *  \param nEntities number of entities of the game
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int replayWrite (const char *name, uint32_t *entry, unsigned int n, unsigned int nEntities);
+
+#endif /* REPLAY_H_ */
@@ -0,0 +1,103 @@
+/**
+ *  \file semBench.c (implementation file)
+ *
+ *  \brief Semaphore management benchmark.
+ *
+ *  Measures the cost of the operations defined in semaphore.h for the implementation it is linked with:
+ *     \li <em>down</em> followed by <em>up</em> of an uncontended semaphore (the common case for a mutex)
+ *     \li ping-pong between two processes, each one blocking on its own semaphore.
+ *
+ *  Upon execution, one optional parameter is accepted:
+ *    \li number of iterations (default 100000).
+ *
+ *  Results are written to stdout as CSV lines: <tt>backend,test,config,iterations,value,unit</tt>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+
+#include "semaphore.h"
+#include "sharedMemory.h"
+
+/** \brief semaphore used as a mutex and to play ping */
+#define  PING           1
+
+/** \brief semaphore used to play pong */
+#define  PONG           2
+
+static double now (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static void check (int r, char *msg)
+{
+    if (r == -1) {
+        perror (msg);
+        exit (EXIT_FAILURE);
+    }
+}
+
+int main (int argc, char *argv[])
+{
+    int key, shmid, semgid, status;
+    long n = 100000, i;
+    double t0;
+    pid_t pid;
+
+    if (argc == 2) {
+        n = strtol (argv[1], NULL, 0);
+    }
+
+    if ((key = ftok (".", 'b')) == -1) {
+        perror ("error on generating the key");
+        exit (EXIT_FAILURE);
+    }
+    check (shmid = shmemCreate (key, sizeof (SEM_SET)), "error on creating the shared memory block");    /* futex set */
+    check (semgid = semCreate (key, 2), "error on creating the semaphore set");
+    check (semSignal (semgid), "error on signaling start of operations");
+
+    /* uncontended down + up */
+    check (semUp (semgid, PING), "error on the up operation");
+    t0 = now ();
+    for (i = 0; i < n; i++) {
+        check (semDown (semgid, PING), "error on the down operation");
+        check (semUp (semgid, PING), "error on the up operation");
+    }
+    printf ("%s,uncontended_down_up,,%ld,%.1f,ns\n", semBackend (), n, (now () - t0) / n);
+    check (semDown (semgid, PING), "error on the down operation");
+
+    /* ping-pong between two processes */
+    fflush (stdout);
+    if ((pid = fork ()) < 0) {
+        perror ("error on the fork operation");
+        exit (EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        for (i = 0; i < n; i++) {
+            check (semDown (semgid, PING), "error on the down operation");
+            check (semUp (semgid, PONG), "error on the up operation");
+        }
+        exit (EXIT_SUCCESS);
+    }
+    t0 = now ();
+    for (i = 0; i < n; i++) {
+        check (semUp (semgid, PING), "error on the up operation");
+        check (semDown (semgid, PONG), "error on the down operation");
+    }
+    printf ("%s,ping_pong_round_trip,,%ld,%.1f,ns\n", semBackend (), n, (now () - t0) / n);
+    waitpid (pid, &status, 0);
+
+    check (semDestroy (semgid), "error on destructing the semaphore set");
+    check (shmemDestroy (shmid), "error on destructing the shared memory block");
+
+    return EXIT_SUCCESS;
+}
@@ -30,18 +30,25 @@
 #include "sharedDataSync.h"
 #include "semaphore.h"
 #include "sharedMemory.h"
+#include "delay.h"
+#include "replay.h"
+#include "team.h"
+#include "barrier.h"
+#include "metrics.h"
+#include "trace.h"
+#include "state.h"
 
 /** \brief logging file name */
-static char nFic[51];
+static ENTITY_LOCAL char nFic[51];
 
 /** \brief shared memory block access identifier */
-static int shmid;
+static ENTITY_LOCAL int shmid;
 
 /** \brief semaphore set access identifier */
-static int semgid;
+static ENTITY_LOCAL int semgid;
 
 /** \brief pointer to shared memory region */
-static SHARED_DATA *sh;
+static ENTITY_LOCAL SHARED_DATA *sh;
 
 /** \brief player takes some time to arrive */
 static void arrive (int id);
@@ -49,6 +56,9 @@ static void arrive (int id);
 /** \brief player constitutes team */
 static int playerConstituteTeam (int id);
 
+/** \brief slot of the team of the player */
+static ENTITY_LOCAL int teamSlot;
+
 /** \brief player waits for referee to start match */
 static void waitReferee(int id, int team);
 
@@ -67,7 +77,7 @@ int main (int argc, char *argv[])
     int n, team;
 
     /* validation of command line parameters */
-    if (argc != 4) { 
+    if ((argc < 4) || (argc > 6)) { 
         freopen ("error_PL", "a", stderr);
         fprintf (stderr, "Number of parameters is incorrect!\n");
         return EXIT_FAILURE;
@@ -76,7 +86,7 @@ int main (int argc, char *argv[])
 
     /* get goalie id - argv[1]*/
     n = (unsigned int) strtol (argv[1], &tinp, 0);
-    if ((*tinp != '\0') || (n >= NUMPLAYERS )) { 
+    if ((*tinp != '\0') || (n < 0)) { 
         fprintf (stderr, "Player process identification is wrong!\n");
         return EXIT_FAILURE;
     }
@@ -84,13 +94,22 @@ int main (int argc, char *argv[])
     /* get logfile name - argv[2]*/
     strcpy (nFic, argv[2]);
 
-    /* redirect stderr to error file  - argv[3]*/
+    /* redirect stderr to error file  - argv[3] (not in the thread engine, stderr is shared by all entities) */
+#ifndef THREAD_ENGINE
     freopen (argv[3], "w", stderr);
     setbuf(stderr,NULL);
+#endif
 
 
-    /* getting key value */
-    if ((key = ftok (".", 'a')) == -1) {
+    /* getting key value - argv[4], if given by the main program */
+    if (argc >= 5) {
+        key = (int) strtol (argv[4], &tinp, 0);
+        if (*tinp != '\0') {
+            fprintf (stderr, "IPC key is wrong!\n");
+            return EXIT_FAILURE;
+        }
+    }
+    else if ((key = ftok (".", 'a')) == -1) {
         perror ("error on generating the key");
         exit (EXIT_FAILURE);
     }
@@ -109,18 +128,45 @@ int main (int argc, char *argv[])
         perror ("error on mapping the shared region on the process address space");
         return EXIT_FAILURE;
     }
+    if (sh->layout != SHARED_LAYOUT) {
+        fprintf (stderr, "shared region layout mismatch (built with a different LAYOUT?)\n");
+        return EXIT_FAILURE;
+    }
+    if ((sh->shmem & SHMEM_PREFAULT) && (shmemPrefault (sh, sh->size) == -1)) {     /* no faults while playing */
+        perror ("error on populating the shared region");
+        return EXIT_FAILURE;
+    }
+    attachLog (&sh->log);
+    if (n >= sh->fSt.nPlayers) {
+        fprintf (stderr, "Player process identification is wrong!\n");
+        return EXIT_FAILURE;
+    }
 
     /* initialize random generator */
-    srandom ((unsigned int) getpid ());                                                 
+    srandom ((sh->seed != 0) ? sh->seed + 1 + n : (unsigned int) getpid ());   /* -S seed of the main program */
+
+    /* simulated delays - argv[5], if given by the main program */
+    delayInit ((argc == 6) ? argv[5] : "1", 'P', n);
+
+    /* events of the entity, if the game is traced (--trace of the main program) */
+    traceOpen (sh->trace, PLAYER_ENTITY (sh, n));
 
 
     /* simulation of the life cycle of the player */
     arrive(n);
-    if((team = playerConstituteTeam(n))!=0) {
+    if (sh->fSt.tournament) {
+        while ((team = playerConstituteTeam(n)) != 0) {           /* players keep playing until all teams are formed */
+            waitReferee(n, team);
+            playUntilEnd(n, team);
+        }
+    }
+    else if((team = playerConstituteTeam(n))!=0) {
         waitReferee(n, team);
         playUntilEnd(n, team);
     }
 
+    traceClose ();
+
     /* unmapping the shared region off the process address space */
     if (shmemDettach (sh) == -1) {
         perror ("error on unmapping the shared region off the process address space");
@@ -139,121 +185,56 @@ int main (int argc, char *argv[])
  */
 static void arrive(int id)
 {    
-    if (semDown (semgid, sh->mutex) == -1)  {                                                     /* enter critical region */
-        perror ("error on the up operation for semaphore access (PL)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here ------------------------------------------------------------*/
-    sh->fSt.st.playerStat[id] = ARRIVING;    //Atualiza estado
-    saveState(nFic, &sh->fSt);               // Salva estado no ficheiro de log
-    
-    if (semUp (semgid, sh->mutex) == -1) {                                                         /* exit critical region */
-        perror ("error on the down operation for semaphore access (PL)");
-        exit (EXIT_FAILURE);
-    }
+    stateChange (semgid, sh, nFic, PLAYER_ENTITY (sh, id), ARRIVING, NULL);    //Atualiza estado
 
-    usleep((200.0*random())/(RAND_MAX+1.0)+50.0);
+    delay(50.0, 200.0);
 }
 
 /**
  *  \brief player constitutes team
  *
- *  If player is late, it updates state and leaves.
- *  If there are enough free players and free goalies to form a team, player forms team allowing 
- *  team members to proceed and waiting for them to acknowledge registration.
- *  Otherwise it updates state, waits for the forming teammate to "call" him, saves its team
- *  and acknowledges registration.
+ *  The arrival of the player is registered in the formation word in the critical region where its state is
+ *  saved, so the log follows the order of the arrivals (see team.h).
+ *  If player is late (all the teams of the game are already formed), it updates state and leaves.
+ *  If there are enough free players and free goalies to form a team, player forms team: it claims a free
+ *  team slot and allows the free team members to proceed.
+ *  Otherwise it updates state and waits for the forming teammate to "call" him.
+ *  Then it registers in the slot of the team of its ticket; the last member to register signals the referee
+ *  (queueing the team). A player called by the former of the last team of the tournament
+ *  has no team left and is late.
  *  The internal state should be saved.
  *
  *  \param id player id
- * 
- *  \return id of player team (0 for late goalies; 1 for team 1; 2 for team 2)
+ *
+ *  \return id of player team (0 if late; odd for team 1 of a match, even for team 2)
  *
  */
-static int playerConstituteTeam (int id){
-    int ret = 0;
-
-    if (semDown (semgid, sh->mutex) == -1)  {                                                     /* enter critical region */
-        perror ("error on the up operation for semaphore access (PL)");
-        exit (EXIT_FAILURE);
+static int playerConstituteTeam (int id)
+{
+    uint64_t word;
+    int arrival, ret;
+
+    stateEnter (semgid, sh, PLAYER_ENTITY (sh, id));
+    arrival = teamArrive(sh, false, &word);                    // Chegada: um só compare and swap, na ordem do log
+    stateSet (sh, nFic, PLAYER_ENTITY (sh, id), (arrival == TEAM_LATE) ? LATE        // LATE soma METRIC_LATE (state.c)
+                                          : (arrival == TEAM_FORM) ? FORMING_TEAM : WAITING_TEAM);
+    if ((arrival == TEAM_FORM) && TEAM_ORDERED (sh)) {
+        teamForm(semgid, sh, false, PLAYER_ENTITY (sh, id), word);         // Reclama um slot e chama os membros livres
     }
+    stateLeave (semgid, sh, nFic, PLAYER_ENTITY (sh, id));
 
-
-    /* TODO: insert your code here -----------------------------------------------------------------------*/
-    sh->fSt.playersFree++;          // Incrementar playersFree
-    sh->fSt.playersArrived++;       // Incremenatr playersArrived
-
-    if (sh->fSt.playersArrived <= 8) {                                                              // Verifica se o player chegou atrasado
-        
-        if ((sh->fSt.playersFree < NUMTEAMPLAYERS) || (sh->fSt.goaliesFree < NUMTEAMGOALIES)) {     // Verifica se tem as condições suficientes para formar equipa
-            
-            sh->fSt.st.playerStat[id] = WAITING_TEAM;                                               // Define o estado do player como WAITING_TEAM
-            saveState(nFic, &sh->fSt);
-        }
-        else {                                                                                      
-            sh->fSt.st.playerStat[id] = FORMING_TEAM;                                               // Define o estado do player como FORMING_TEAM
-            saveState(nFic, &sh->fSt);
-
-            sh->fSt.playersFree -= NUMTEAMPLAYERS;          // Decrementar nº de jogadores que não se encontram mais livres
-            sh->fSt.goaliesFree -= NUMTEAMGOALIES;          // Decrementar nº de goalies que não se encontram mais livres
-
-            if (semUp(semgid, sh->goaliesWaitTeam) == -1) {
-                perror("Error on the up operation for semaphore access (PL)");      // Desbloquear goalie para que se possa juntar à equipa
-                exit(EXIT_FAILURE);
-            }
-
-            if (semDown(semgid, sh->playerRegistered) == -1) {
-                perror("error on the up operation for semaphore access (PL)");      // Espera que goalie esteja registado
-                exit(EXIT_FAILURE);
-            }
-
-            for (int i = 0; i < NUMTEAMPLAYERS - 1; i++) {  
-                if (semUp(semgid, sh->playersWaitTeam) == -1) {
-                    perror("Error on the up operation for semaphore access (PL)");  // Desbloquear players para que se juntem à equipa
-                    exit(EXIT_FAILURE);
-                }
-                                                          
-                if (semDown(semgid, sh->playerRegistered) == -1) {                  // Espera que os jogadores estejam registrados na equipa
-                    perror("error on the up operation for semaphore access (PL)");
-                    exit(EXIT_FAILURE);
-                }
-                
-            }
-
-            ret = sh->fSt.teamId++;     // retirar e incrementar id da equipa
-
-            if (semUp(semgid, sh->refereeWaitTeams) == -1) {                        // Sinalizar referee para que se criem as equipas
-                perror("error on the up operation for semaphore access (PL)");
-                exit(EXIT_FAILURE);
-            }
-        }
+    if (arrival == TEAM_LATE) {
+        return 0;
     }
-    else {
-        ret = 0;
-        sh->fSt.st.playerStat[id] = LATE;       // Player encontra-se atrasado 
-        saveState(nFic, &sh->fSt);
+    if (arrival == TEAM_WAIT) {
+        teamWait(semgid, sh, false, PLAYER_ENTITY (sh, id));               // Espera que exista uma equipa para se juntar
     }
-    
-    if (semUp (semgid, sh->mutex) == -1) {                                                         /* exit critical region */
-        perror ("error on the down operation for semaphore access (PL)");
-        exit (EXIT_FAILURE);
+    else if (!TEAM_ORDERED (sh)) {
+        teamForm(semgid, sh, false, PLAYER_ENTITY (sh, id), word);         // Reclama um slot e chama os membros livres
     }
 
-    /* TODO: insert your code here -----------------------------------------------------------*/
-    // Caso em que o jogador se encontra à espera para formar equipa
-    if (sh->fSt.st.playerStat[id] == WAITING_TEAM) {
-        if (semDown(semgid, sh->playersWaitTeam) == -1) {
-            perror("error on the up operation for semaphore access (PL)");      // bloquear jogador até que exista uma equipa para ele se juntar
-            exit(EXIT_FAILURE);
-        }
-
-        ret = sh->fSt.teamId;       // atribuir id de equipa
-
-        if (semUp(semgid, sh->playerRegistered) == -1) {                        // Regista o player
-            perror("error on the up operation for semaphore access (GL)");
-            exit(EXIT_FAILURE);
-        }
+    if ((ret = teamJoin(semgid, sh, false, PLAYER_ENTITY (sh, id), &teamSlot)) == 0) {      // Torneio terminou sem equipa para ele
+        stateChange (semgid, sh, nFic, PLAYER_ENTITY (sh, id), LATE, NULL);
     }
 
     return ret;
@@ -263,6 +244,8 @@ static int playerConstituteTeam (int id){
  *  \brief player waits for referee to start match
  *
  *  The player updates its state and waits for referee to end match.  
+ *  The meeting with the team at the barrier of its slot is the synchronization of the state, carried out by
+ *  stateChange.
  *  The internal state should be saved.
  *
  *  \param id   player id
@@ -270,38 +253,16 @@ static int playerConstituteTeam (int id){
  */
 static void waitReferee (int id, int team)
 {
-    if (semDown (semgid, sh->mutex) == -1)  {                                                     /* enter critical region */
-        perror ("error on the up operation for semaphore access (PL)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here -----------------------------------------------------------------*/
-    sh->fSt.st.playerStat[id] = (team == 1) ? WAITING_START_1 : WAITING_START_2;                   // Muda o estado do player para WAITING_START
-    saveState(nFic, &sh->fSt);
-
-
-    if (semUp (semgid, sh->mutex) == -1) {                                                         /* exit critical region */
-        perror ("error on the down operation for semaphore access (PL)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here ----------------------------------------------------------------*/
-    if (semDown(semgid, sh->playersWaitReferee) == -1) {                                          // Faz o player esperar pelo arbitro
-        perror("error on the up operation for semaphore access(GL)");
-        exit(EXIT_FAILURE);
-    }
-    
-    if (semUp(semgid, sh->playing) == -1) {                                                       // Sinal ao arbitro que o players está pronto
-        perror("Error signaling referee (waitReferee)");
-        exit(EXIT_FAILURE);
-    }
-
+    stateChange (semgid, sh, nFic, PLAYER_ENTITY (sh, id),    // Muda o estado do player para WAITING_START
+                 (team % NUMTEAMS == 1) ? WAITING_START_1 : WAITING_START_2, &teamSlot);
 }
 
 /**
  *  \brief player waits for referee to end match
  *
  *  The player updates its state and waits for referee to end match.  
+ *  The meeting with the team at the barrier of its slot is the synchronization of the state, carried out by
+ *  stateChange.
  *  The internal state should be saved.
  *
  *  \param id   player id
@@ -309,26 +270,8 @@ static void waitReferee (int id, int team)
  */
 static void playUntilEnd (int id, int team)
 {
-    if (semDown (semgid, sh->mutex) == -1)  {                                                     /* enter critical region */
-        perror ("error on the up operation for semaphore access (PL)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here --------------------------------------------------------------------*/
-    sh->fSt.st.playerStat[id] = (team == 1) ? PLAYING_1 : PLAYING_2;                            // Atualiza o estado do player para PLAYING
-    saveState(nFic, &sh->fSt);
-
-    if (semUp (semgid, sh->mutex) == -1) {                                                         /* exit critical region */
-        perror ("error on the down operation for semaphore access (PL)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here -------------------------------------------------------------------*/
-    if (semDown(semgid, sh->playersWaitEnd) == -1) {                                            // Faz o player esperar pelo final do jogo
-        perror("error on the up operation for semaphore access(GL)");
-        exit(EXIT_FAILURE);
-    }
-
+    stateChange (semgid, sh, nFic, PLAYER_ENTITY (sh, id),    // Atualiza o estado do player para PLAYING
+                 (team % NUMTEAMS == 1) ? PLAYING_1 : PLAYING_2, &teamSlot);
 }
 
 
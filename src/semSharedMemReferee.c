@@ -9,6 +9,7 @@
  *  Definition of the operations carried out by the referee:
  *     \li arrive
  *     \li waitForTeams
+ *     \li waitForMatch
  *     \li startGame
  *     \li play
  *     \li endgame
@@ -34,34 +35,47 @@
 #include "sharedDataSync.h"
 #include "semaphore.h"
 #include "sharedMemory.h"
+#include "delay.h"
+#include "replay.h"
+#include "team.h"
+#include "barrier.h"
+#include "metrics.h"
+#include "trace.h"
+#include "state.h"
 
 
 /** \brief logging file name */
-static char nFic[51];
+static ENTITY_LOCAL char nFic[51];
 
 /** \brief shared memory block access identifier */
-static int shmid;
+static ENTITY_LOCAL int shmid;
 
 /** \brief semaphore set access identifier */
-static int semgid;
+static ENTITY_LOCAL int semgid;
 
 /** \brief pointer to shared memory region */
-static SHARED_DATA *sh;
+static ENTITY_LOCAL SHARED_DATA *sh;
+
+/** \brief team slots of the match of the referee */
+static ENTITY_LOCAL int match[NUMTEAMS];
 
 /** \brief referee takes some time to arrive */
-static void arrive ();
+static void arrive (int id);
 
 /** \brief referee waits for teams to be formed */
-static void waitForTeams ();
+static void waitForTeams (int id);
+
+/** \brief referee waits for the next two queued teams */
+static bool waitForMatch (int id);
 
 /** \brief referee starts game */
-static void startGame ();
+static void startGame (int id);
 
 /** \brief referee takes some time to allow game to finish */
-static void play ();
+static void play (int id);
 
 /** \brief referee ends game */
-static void endGame ();
+static void endGame (int id);
 
 /**
  *  \brief Main program.
@@ -71,25 +85,41 @@ static void endGame ();
 int main (int argc, char *argv[])
 {
     int key;                                          /*access key to shared memory and semaphore set */
+    char *tinp;                                                       /* numerical parameters test flag */
+    int n;
 
     /* validation of command line parameters */
-    if (argc != 4) { 
+    if ((argc < 4) || (argc > 6)) { 
         freopen ("error_RF", "a", stderr);
         fprintf (stderr, "Number of parameters is incorrect!\n");
         return EXIT_FAILURE;
     }
 
-    /* argv[1] may be ignored as there is only one referee - id=0 */
+    /* get referee id - argv[1]*/
+    n = (unsigned int) strtol (argv[1], &tinp, 0);
+    if ((*tinp != '\0') || (n < 0)) { 
+        fprintf (stderr, "Referee process identification is wrong!\n");
+        return EXIT_FAILURE;
+    }
 
     /* get logfile name - argv[2]*/
     strcpy (nFic, argv[2]);
 
-    /* redirect stderr to error file  - argv[3]*/
+    /* redirect stderr to error file  - argv[3] (not in the thread engine, stderr is shared by all entities) */
+#ifndef THREAD_ENGINE
     freopen (argv[3], "w", stderr);
     setbuf(stderr,NULL);
-
-    /* getting key value */
-    if ((key = ftok (".", 'a')) == -1) {
+#endif
+
+    /* getting key value - argv[4], if given by the main program */
+    if (argc >= 5) {
+        key = (int) strtol (argv[4], &tinp, 0);
+        if (*tinp != '\0') {
+            fprintf (stderr, "IPC key is wrong!\n");
+            return EXIT_FAILURE;
+        }
+    }
+    else if ((key = ftok (".", 'a')) == -1) {
         perror ("error on generating the key");
         exit (EXIT_FAILURE);
     }
@@ -108,16 +138,45 @@ int main (int argc, char *argv[])
         perror ("error on mapping the shared region on the process address space");
         return EXIT_FAILURE;
     }
+    if (sh->layout != SHARED_LAYOUT) {
+        fprintf (stderr, "shared region layout mismatch (built with a different LAYOUT?)\n");
+        return EXIT_FAILURE;
+    }
+    if ((sh->shmem & SHMEM_PREFAULT) && (shmemPrefault (sh, sh->size) == -1)) {     /* no faults while playing */
+        perror ("error on populating the shared region");
+        return EXIT_FAILURE;
+    }
+    attachLog (&sh->log);
+    if (n >= sh->fSt.nReferees) {
+        fprintf (stderr, "Referee process identification is wrong!\n");
+        return EXIT_FAILURE;
+    }
 
     /* initialize random generator */
-    srandom ((unsigned int) getpid ());                                      
+    srandom ((sh->seed != 0) ? sh->seed + 1 + sh->fSt.nPlayers + sh->fSt.nGoalies + n : (unsigned int) getpid ());   /* -S seed of the main program */
+
+    /* simulated delays - argv[5], if given by the main program */
+    delayInit ((argc == 6) ? argv[5] : "1", 'R', n);
+
+    /* events of the entity, if the game is traced (--trace of the main program) */
+    traceOpen (sh->trace, REFEREE_ENTITY (sh, n));
 
     /* simulation of the life cycle of the referee */
-    arrive();
-    waitForTeams();
-    startGame();
-    play();
-    endGame();
+    arrive(n);
+    if (sh->fSt.tournament) {
+        while (waitForMatch(n)) {                                       /* referees keep refereeing queued teams */
+            startGame(n);
+            play(n);
+            endGame(n);
+        }
+    }
+    else if (waitForMatch(n)) {
+        startGame(n);
+        play(n);
+        endGame(n);
+    }
+
+    traceClose ();
 
     /* unmapping the shared region off the process address space */
     if (shmemDettach (sh) == -1) { 
@@ -134,24 +193,13 @@ int main (int argc, char *argv[])
  *  Referee updates state and takes some time to arrive
  *  The internal state should be saved.
  *
+ *  \param id referee id
  */
-static void arrive ()
+static void arrive (int id)
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      /* enter critical region */
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here */
-    sh->fSt.st.refereeStat = ARRIVINGR;  // Atribuir estado "ARRIVINGR" ao arbitro
-    saveState(nFic, &sh->fSt);
-
-    if (semUp (semgid, sh->mutex) == -1) {                                                        /* leave critical region */
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
+    stateChange (semgid, sh, nFic, REFEREE_ENTITY (sh, id), ARRIVINGR, NULL);    // Atribuir estado "ARRIVINGR" ao arbitro
     
-    usleep((100.0*random())/(RAND_MAX+1.0)+10.0);
+    delay(10.0, 100.0);
    
 }
 
@@ -159,81 +207,28 @@ static void arrive ()
  *  \brief referee waits for teams to be formed
  *
  *  Referee updates state and waits for the 2 teams to be completely formed
+ *  The wait for each team is carried out by waitForMatch, which takes the teams off the queue.
  *  The internal state should be saved.
  *
+ *  \param id referee id
  */
-static void waitForTeams ()
+static void waitForTeams (int id)
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      /* enter critical region */
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here */
-    sh->fSt.st.refereeStat = WAITING_TEAMS; // atribuir estado "WAITING_TEAMS ao arbitro"
-    saveState(nFic, &sh->fSt);
-
-    if (semUp (semgid, sh->mutex) == -1) {                                                        /* leave critical region */
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here */
-    // código responsável pela espera do arbitro por cada uma das equipas
-
-    if(semDown(semgid, sh->refereeWaitTeams) == -1){
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
-    if(semDown(semgid, sh->refereeWaitTeams) == -1){
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
+    stateChange (semgid, sh, nFic, REFEREE_ENTITY (sh, id), WAITING_TEAMS, NULL);    // atribuir estado "WAITING_TEAMS ao arbitro"
 }
 
 /**
  *  \brief referee starts game
  *
  *  Referee updates state and notifies players and goalies to start match
+ *  The meeting with both teams at their barriers is the synchronization of the state, carried out by stateChange.
  *  The internal state should be saved.
  *
+ *  \param id referee id
  */
-static void startGame ()
+static void startGame (int id)
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      /* enter critical region */
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here */
-    // Alterar estado do arbitro para "STARTING_GAME"
-    sh->fSt.st.refereeStat = STARTING_GAME;
-    saveState(nFic, &sh->fSt);
-
-    if (semUp (semgid, sh->mutex) == -1) {                                                        /* leave critical region */
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here */
-    // É necessário passar a informação aos players e goalies que o jogo pode começar, incrementando o semaforo playersWaitReferee 10x e decrementando o semáforo playing 10x
-
-    for(int i = 0; i < NUMPLAYERS; i++){
-        if(semUp(semgid, sh->playersWaitReferee) == -1){
-            perror ("error on the up operation for semaphore access (RF)");
-            exit (EXIT_FAILURE);
-        }
-    }
-    
-    for(int i = 0; i < NUMPLAYERS; i++){
-        if(semDown(semgid, sh->playing) == -1){
-            perror ("error on the up operation for semaphore access (RF)");
-            exit (EXIT_FAILURE);
-        }
-    }
-
+    stateChange (semgid, sh, nFic, REFEREE_ENTITY (sh, id), STARTING_GAME, match);    // Alterar estado do arbitro para "STARTING_GAME"
 }
 
 /**
@@ -242,58 +237,44 @@ static void startGame ()
  *  Referee updates state and takes some time to finish the game 
  *  The internal state should be saved.
  *
+ *  \param id referee id
  */
-static void play ()
+static void play (int id)
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      /* enter critical region */
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
+    stateChange (semgid, sh, nFic, REFEREE_ENTITY (sh, id), REFEREEING, NULL);    // alterar estado do arbitro para "REFEREEING"
 
-    /* TODO: insert your code here */
-    // alterar estado do arbitro para "REFEREEING"
-    sh->fSt.st.refereeStat = REFEREEING;
-    saveState(nFic, &sh->fSt);
-
-    if (semUp (semgid, sh->mutex) == -1) {                                                        /* leave critical region */
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
-    usleep((100.0*random())/(RAND_MAX+1.0)+900.0);
+    delay(900.0, 100.0);
 }
 
 /**
  *  \brief referee ends game
  *
  *  Referee updates state and notifies players and goalies to end match
+ *  The meeting with both teams at their barriers, and the release of their slots, is the synchronization of the
+ *  state, carried out by stateChange.
  *  The internal state should be saved.
  *
+ *  \param id referee id
  */
-static void endGame ()
+static void endGame (int id)
 {
-    if (semDown (semgid, sh->mutex) == -1) {                                                      /* enter critical region */
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
-
-    /* TODO: insert your code here */
-    // alterar estado do arbitro para "ENDING_GAME"
-    sh->fSt.st.refereeStat = ENDING_GAME;
-    saveState(nFic, &sh->fSt);
-
-    if (semUp (semgid, sh->mutex) == -1) {                                                        /* leave critical region */
-        perror ("error on the up operation for semaphore access (RF)");
-        exit (EXIT_FAILURE);
-    }
+    stateChange (semgid, sh, nFic, REFEREE_ENTITY (sh, id), ENDING_GAME, match);    // alterar estado do arbitro para "ENDING_GAME"
+}
 
-    /* TODO: insert your code here */
-    // desbloquear semaforo playersWaitEnd para cada player/goalie que estava à espera que o jogo terminasse
-    for(int i = 0; i < 10; i++){
-        if(semUp(semgid, sh->playersWaitEnd) == -1){
-            perror ("error on the up operation for semaphore access (RF)");
-            exit (EXIT_FAILURE);
-        }
-    }
+/**
+ *  \brief referee waits for the next two queued teams
+ *
+ *  Referee updates state, waits for 2 teams to be queued and takes them off the queue.
+ *  In tournament mode the referee leaves when the teams of all matches have already been taken by the referees.
+ *  The internal state should be saved.
+ *
+ *  \param id referee id
+ *
+ *  \return true if the referee has a match to referee
+ */
+static bool waitForMatch (int id)
+{
+    waitForTeams(id);
 
+    return teamTake(semgid, sh, id, REFEREE_ENTITY (sh, id), match);       // Sem equipas na fila o torneio terminou
 }
@@ -9,20 +9,182 @@
  *     \li destruction of a previously created set of semaphores
  *     \li signalling start of operations
  *     \li <em>down</em> of a semaphore within the set
- *     \li <em>up</em> of a semaphore within the set.
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li <em>down</em> of a semaphore within the set by more than one unit
+ *     \li <em>up</em> of a semaphore within the set by more than one unit
+ *     \li atomic execution of an array of operations on semaphores within the set
+ *     \li printing of the latency statistics.
+ *
+ *  When compiled with <tt>SEM_STATS</tt> (<tt>make stats</tt>), <em>down</em> and <em>up</em> are timed with
+ *  <tt>CLOCK_MONOTONIC</tt>: the time blocked in each <em>down</em> (wait) and the time from a <em>down</em> to the
+ *  next <em>up</em> of the same semaphore by the same process (hold, the critical region for a mutex) are
+ *  counted in log2 buckets of nanoseconds, per semaphore location and per process, in a shared memory block
+ *  of their own whose key is obtained from the creation key by replacing the project id byte by <tt>'h'</tt>.
  *
  *  \author António Rui Borges - October 1995
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/sem.h>
+#include <sys/shm.h>
 #include <assert.h>
 
+#include "semaphore.h"
+#include "trace.h"
+
 /** \brief access permission: user r-w */
 #define  MASK           0600
 
+#ifdef SEM_STATS
+
+/** \brief project id used to derive the key of the block holding the statistics */
+#define  STAT_PROJ_ID   'h'
+
+/** \brief number of log2 buckets of a histogram (the last one also counts the longer times) */
+#define  STAT_BUCKETS   40
+
+/** \brief number of processes with histograms of their own (the last ones share the last slot) */
+#define  STAT_SLOTS     64
+
+/** \brief kinds of times: blocked in a down, from a down to an up */
+enum { STAT_WAIT, STAT_HOLD, STAT_KINDS };
+
+/**
+ *  \brief Definition of <em>latency histogram</em> data type.
+ */
+typedef struct {
+    /** \brief number of times counted */
+    uint64_t count;
+    /** \brief longest time (ns) */
+    uint64_t max;
+    /** \brief bucket b counts the times t (ns) with 2^(b-1) <= t < 2^b (bucket 0 counts t = 0) */
+    uint64_t bucket[STAT_BUCKETS];
+} SEM_HIST;
+
+/**
+ *  \brief Definition of <em>latency statistics block</em> data type.
+ */
+typedef struct {
+    /** \brief number of slots claimed so far */
+    unsigned int nSlots;
+    /** \brief histograms of each process, per semaphore location (location 0 counts those beyond SEM_STAT_NUM) */
+    SEM_HIST hist[STAT_SLOTS][SEM_STAT_NUM][STAT_KINDS];
+} SEM_STAT_BLOCK;
+
+/** \brief identifier of the statistics block (-1 if none) */
+static int statId = -1;
+
+/** \brief local address of the statistics block (NULL if not mapped) */
+static SEM_STAT_BLOCK *statBlock = NULL;
+
+/** \brief histogram slot of this process */
+static unsigned int statSlot;
+
+/** \brief time of the last down of each semaphore location not yet followed by an up (0 if none) */
+static uint64_t downAt[SEM_STAT_NUM];
+
+static int statKey (int key)
+{
+  return (int) (((unsigned int) key & 0x00ffffffu) | ((unsigned int) STAT_PROJ_ID << 24));
+}
+
+static uint64_t now (void)
+{
+  struct timespec t;
+
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return (uint64_t) t.tv_sec * 1000000000u + (uint64_t) t.tv_nsec;
+}
+
+/** \brief map the statistics block and claim a slot for this process */
+static void statAttach (int shmid)
+{
+  void *add;
+  unsigned int slot;
+
+  if ((shmid == -1) || ((add = shmat (shmid, (char *) NULL, 0)) == (void *) -1))
+     return;
+  if (statBlock != NULL)
+     shmdt (statBlock);
+  statBlock = (SEM_STAT_BLOCK *) add;
+  statId = shmid;
+  slot = __atomic_fetch_add (&statBlock->nSlots, 1, __ATOMIC_RELAXED);
+  statSlot = (slot < STAT_SLOTS) ? slot : STAT_SLOTS - 1;
+  memset (downAt, 0, sizeof (downAt));
+}
+
+/** \brief count the time <tt>t</tt> (ns) of kind <tt>kind</tt> for semaphore location <tt>sindex</tt> */
+static void statCount (unsigned int sindex, int kind, uint64_t t)
+{
+  SEM_HIST *h = &statBlock->hist[statSlot][(sindex < SEM_STAT_NUM) ? sindex : 0][kind];
+  unsigned int b = (t == 0) ? 0 : 64 - __builtin_clzll (t);
+  uint64_t max = __atomic_load_n (&h->max, __ATOMIC_RELAXED);
+
+  __atomic_fetch_add (&h->count, 1, __ATOMIC_RELAXED);            /* the last slot may be shared by processes */
+  __atomic_fetch_add (&h->bucket[(b < STAT_BUCKETS) ? b : STAT_BUCKETS - 1], 1, __ATOMIC_RELAXED);
+  while ((t > max) && !__atomic_compare_exchange_n (&h->max, &max, t, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+/** \brief blocking down of <tt>n</tt> units, timed */
+static int statDown (int semgid, struct sembuf *down)
+{
+  unsigned int i = (down->sem_num < SEM_STAT_NUM) ? down->sem_num : 0;
+  uint64_t t0, t1;
+  int status;
+
+  if (statBlock == NULL)
+     return semop (semgid, down, 1);
+  t0 = now ();
+  status = semop (semgid, down, 1);
+  t1 = now ();
+  statCount (down->sem_num, STAT_WAIT, t1 - t0);
+  downAt[i] = t1;
+  return status;
+}
+
+/** \brief up of <tt>n</tt> units, timing the hold since the last down of the same location */
+static int statUp (int semgid, struct sembuf *up)
+{
+  unsigned int i = (up->sem_num < SEM_STAT_NUM) ? up->sem_num : 0;
+
+  if ((statBlock != NULL) && (downAt[i] != 0))
+     { statCount (up->sem_num, STAT_HOLD, now () - downAt[i]);
+       downAt[i] = 0;
+     }
+  return semop (semgid, up, 1);
+}
+
+/** \brief time (ns) below which a fraction <tt>q</tt> of the counted times are (upper bound of a bucket) */
+static uint64_t percentile (SEM_HIST *h, double q)
+{
+  uint64_t n = 0, rank = (uint64_t) (q * h->count + 0.5);
+  unsigned int b;
+
+  if (rank == 0) rank = 1;
+  for (b = 0; b < STAT_BUCKETS; b++)
+    if ((n += h->bucket[b]) >= rank)
+       break;
+  if ((b == 0) || (b >= 64) || ((1ull << b) - 1 > h->max))
+     return h->max;
+  return (1ull << b) - 1;
+}
+
+#define  SEMOP_DOWN(semgid,op)   statDown (semgid, op)
+#define  SEMOP_UP(semgid,op)     statUp (semgid, op)
+#else
+#define  SEMOP_DOWN(semgid,op)   semop (semgid, op, 1)
+#define  SEMOP_UP(semgid,op)     semop (semgid, op, 1)
+#endif
+
 /**
  *  \brief Creation of a set of semaphores.
  *
@@ -38,7 +200,13 @@
 
 int semCreate (int key, unsigned int snum)
 {
-  return semget ((key_t) key, snum+1, MASK | IPC_CREAT | IPC_EXCL);
+  int semgid = semget ((key_t) key, snum+1, MASK | IPC_CREAT | IPC_EXCL);
+
+#ifdef SEM_STATS
+  if (semgid != -1)
+     statAttach (shmget ((key_t) statKey (key), sizeof (SEM_STAT_BLOCK), MASK | IPC_CREAT | IPC_EXCL));
+#endif
+  return semgid;
 }
 
 /**
@@ -61,7 +229,10 @@ int semConnect (int key)
      return -1;
      else if (semop (semgid, init, 2) == -1)
              return -1;
-             else return semgid;
+#ifdef SEM_STATS
+  statAttach (shmget ((key_t) statKey (key), sizeof (SEM_STAT_BLOCK), MASK));
+#endif
+  return semgid;
 }
 
 /**
@@ -77,9 +248,78 @@ int semConnect (int key)
 
 int semDestroy (int semgid)
 {
+#ifdef SEM_STATS
+  if (statBlock != NULL)
+     { shmdt (statBlock);
+       shmctl (statId, IPC_RMID, NULL);
+       statBlock = NULL;
+     }
+#endif
   return semctl (semgid, 0, IPC_RMID, NULL);
 }
 
+/**
+ *  \brief Destruction of a stale set of semaphores.
+ *
+ *  The set with a creation key equal to <tt>key</tt>, if any, is destroyed. It must be known to be stale: the
+ *  caller holds the shared memory block with the same key, so no simulation may be using the set.
+ *
+ *  \param key creation key
+ *
+ *  \return \c 1, if a set was destroyed
+ *  \return \c 0, if there is no set with that key
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semReclaim (int key)
+{
+  int semgid, found = 0;
+
+#ifdef SEM_STATS
+  int shmid;
+
+  if ((shmid = shmget ((key_t) statKey (key), 0, MASK)) != -1)
+     { if (shmctl (shmid, IPC_RMID, NULL) == -1)
+          return -1;
+       found = 1;
+     }
+#endif
+  if ((semgid = semget ((key_t) key, 0, MASK)) == -1)
+     return ((errno == ENOENT) || found) ? found : -1;
+  return (semctl (semgid, 0, IPC_RMID, NULL) == -1) ? -1 : 1;
+}
+
+/**
+ *  \brief Reset of a previously created set of semaphores.
+ *
+ *  All semaphores in the set, including the one used to signal the start of operations, are put back in
+ *  <em>red state</em>, so the set may be reused for a new simulation. No process may be using the set.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semReset (int semgid)
+{
+  union semun { int val; struct semid_ds *buf; unsigned short *array; } arg;               /* semctl argument */
+  struct semid_ds ds;                                                                          /* set status */
+  unsigned short *val;                                                                   /* semaphore values */
+  int stat;
+
+  arg.buf = &ds;
+  if (semctl (semgid, 0, IPC_STAT, arg) == -1)
+     return -1;
+  if ((val = calloc (ds.sem_nsems, sizeof (unsigned short))) == NULL)
+     return -1;
+  arg.array = val;
+  stat = semctl (semgid, 0, SETALL, arg);
+  free (val);
+  return stat;
+}
+
 /**
  *  \brief Signalling start of operations upon initialization of shared data structures.
  *
@@ -116,7 +356,7 @@ int semDown (int semgid, unsigned int sindex)
 
   assert(sindex>0);
   down.sem_num = (unsigned short) sindex;
-  return semop (semgid, &down, 1);
+  return TRACED (TRACE_DOWN, sindex, SEMOP_DOWN (semgid, &down));
 }
 
 /**
@@ -137,5 +377,187 @@ int semUp (int semgid, unsigned int sindex)
 
   assert(sindex>0);
   up.sem_num = (unsigned short) sindex;
-  return semop (semgid, &up, 1);
+  return TRACED (TRACE_UP, sindex, SEMOP_UP (semgid, &up));
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set by <tt>n</tt> units.
+ *
+ *  A single operation is carried out: the process blocks until the semaphore value is at least <tt>n</tt>.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDownN (int semgid, unsigned int sindex, unsigned int n)
+{
+  struct sembuf down = { 0, 0, 0 };                                                       /* specific down operation */
+
+  assert(sindex>0);
+  assert(n>0);
+  down.sem_num = (unsigned short) sindex;
+  down.sem_op = (short) -n;
+  return TRACED (TRACE_DOWN, sindex, SEMOP_DOWN (semgid, &down));
+}
+
+/**
+ *  \brief <em>Up</em> of a semaphore within the set by <tt>n</tt> units.
+ *
+ *  A single operation is carried out, equivalent to <tt>n</tt> consecutive <em>up</em>s.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semUpN (int semgid, unsigned int sindex, unsigned int n)
+{
+  struct sembuf up = { 0, 0, 0 };                                                           /* specific up operation */
+
+  assert(sindex>0);
+  assert(n>0);
+  up.sem_num = (unsigned short) sindex;
+  up.sem_op = (short) n;
+  return TRACED (TRACE_UP, sindex, SEMOP_UP (semgid, &up));
+}
+
+/**
+ *  \brief Atomic execution of an array of operations on semaphores within the set.
+ *
+ *  Either all operations are carried out or the process blocks until they all can be.
+ *  <tt>sem_num</tt> of each operation is the semaphore location in the set (1 .. snum), <tt>sem_op</tt> the
+ *  (signed) number of units and <tt>sem_flg</tt> is usually 0.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param ops array of operations
+ *  \param nops number of operations in the array (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semOps (int semgid, struct sembuf *ops, unsigned int nops)
+{
+  unsigned int i;
+
+  for (i = 0; i < nops; i++)
+    assert(ops[i].sem_num>0);
+  return TRACED (TRACE_OPS, ops[0].sem_num, semop (semgid, ops, nops));
+}
+
+/**
+ *  \brief Reading of the values of the semaphores of the set.
+ *
+ *  The values of locations 0 (start of operations) .. <tt>n</tt> - 1 are stored in <tt>val</tt>, as many as there are.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param val array where the values are stored
+ *  \param n number of entries of val
+ *
+ *  \return number of semaphores in the set (including location 0), upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semValues (int semgid, unsigned int *val, unsigned int n)
+{
+  union semun { int val; struct semid_ds *buf; unsigned short *array; } arg;               /* semctl argument */
+  struct semid_ds ds;                                                                          /* set status */
+  unsigned short *all;                                                                   /* semaphore values */
+  unsigned int i;
+
+  arg.buf = &ds;
+  if (semctl (semgid, 0, IPC_STAT, arg) == -1)
+     return -1;
+  if ((all = calloc (ds.sem_nsems, sizeof (unsigned short))) == NULL)
+     return -1;
+  arg.array = all;
+  if (semctl (semgid, 0, GETALL, arg) == -1)
+     { free (all);
+       return -1;
+     }
+  for (i = 0; (i < n) && (i < ds.sem_nsems); i++)
+    val[i] = all[i];
+  free (all);
+  return (int) ds.sem_nsems;
+}
+
+/**
+ *  \brief Name of the semaphore implementation.
+ *
+ *  \return <tt>"sysv"</tt>
+ */
+
+const char *semBackend (void)
+{
+  return "sysv";
+}
+
+/**
+ *  \brief Printing of the latency statistics.
+ *
+ *  The histograms of all processes are merged and, for each semaphore location and kind of time with some
+ *  count, a line with the count, the median, the 99th percentile and the maximum (ns) is printed. Percentiles
+ *  are upper bounds of log2 buckets. Nothing is printed unless compiled with <tt>SEM_STATS</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param name names of the semaphore locations (NULL entries, or locations beyond nNames, are numbered)
+ *  \param nNames number of entries of name
+ *  \param fp stream the statistics are printed to
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semStatDump (int semgid, const char *name[], unsigned int nNames, FILE *fp)
+{
+  (void) semgid;
+#ifdef SEM_STATS
+  static const char *kindName[STAT_KINDS] = { "wait", "hold" };
+  SEM_HIST h;
+  char label[32];
+  unsigned int i, p, b;
+  int k;
+
+  if (statBlock == NULL)
+     return 0;
+  fprintf (fp, "%-20s %-4s %10s %12s %12s %12s\n", "semaphore", "time", "count", "p50 (ns)", "p99 (ns)", "max (ns)");
+  for (i = 0; i < SEM_STAT_NUM; i++)
+    for (k = 0; k < STAT_KINDS; k++)
+    { memset (&h, 0, sizeof (h));
+      for (p = 0; p < STAT_SLOTS; p++)
+      { SEM_HIST *ph = &statBlock->hist[p][i][k];
+
+        h.count += ph->count;
+        if (ph->max > h.max) h.max = ph->max;
+        for (b = 0; b < STAT_BUCKETS; b++)
+          h.bucket[b] += ph->bucket[b];
+      }
+      if (h.count == 0)
+         continue;
+      if (i == 0)
+         snprintf (label, sizeof (label), "others (>= %d)", SEM_STAT_NUM);
+         else if ((i < nNames) && (name[i] != NULL))
+                 snprintf (label, sizeof (label), "%s", name[i]);
+                 else snprintf (label, sizeof (label), "sem %u", i);
+      fprintf (fp, "%-20s %-4s %10llu %12llu %12llu %12llu\n", label, kindName[k], (unsigned long long) h.count,
+               (unsigned long long) percentile (&h, 0.5), (unsigned long long) percentile (&h, 0.99),
+               (unsigned long long) h.max);
+    }
+#else
+  (void) name;
+  (void) nNames;
+  (void) fp;
+#endif
+  return 0;
 }
@@ -9,7 +9,14 @@
  *     \li destruction of a previously created set of semaphores
  *     \li signalling start of operations
  *     \li <em>down</em> of a semaphore within the set
- *     \li <em>up</em> of a semaphore within the set.
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li <em>down</em> of a semaphore within the set by more than one unit
+ *     \li <em>up</em> of a semaphore within the set by more than one unit
+ *     \li atomic execution of an array of operations on semaphores within the set.
+ *
+ *  Two implementations are available, selected at build time: SVIPC semaphores (semaphore.c, default) and
+ *  futexes (semaphoreFutex.c, <tt>make SEM_BACKEND=futex</tt>). The futex semaphores have no IPC object of
+ *  their own: they live at the start of the shared memory block with the same creation key (see SEM_SET).
  *
  *  \author António Rui Borges - October 1995
  */
@@ -17,6 +24,44 @@
 #ifndef SEMAPHORE_H_
 #define SEMAPHORE_H_
 
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/sem.h>
+
+/** \brief number of semaphore locations with latency statistics of their own (SEM_STATS builds) */
+#define  SEM_STAT_NUM   16
+
+/** \brief maximum number of semaphores in a set of the futex implementation (besides location 0) */
+#define  SEM_SET_MAX    7
+
+/**
+ *  \brief Definition of <em>futex semaphore</em> data type.
+ *
+ *  Each semaphore has a cache line of its own, so that operations on different semaphores do not interfere.
+ */
+typedef struct {
+    /** \brief semaphore value (the futex word) */
+    unsigned int val;
+    /** \brief number of processes blocked on the semaphore */
+    unsigned int waiters;
+    /** \brief number of processes blocked waiting for more than one unit (wake up all on up while not 0) */
+    unsigned int multi;
+} __attribute__ ((aligned (64))) FSEM;
+
+/**
+ *  \brief Definition of <em>futex semaphore set</em> data type.
+ *
+ *  The futex implementation keeps the set at the start of the shared memory block whose creation key is the
+ *  one of the set, so the block must be created (shmemCreate) before the set and its data type must have a
+ *  member of this type first. The SVIPC implementation does not use it.
+ */
+typedef struct {
+    /** \brief number of semaphores in the set (including the start of operations semaphore) */
+    unsigned int snum;
+    /** \brief semaphores, location 0 is used to signal start of operations */
+    FSEM sem[SEM_SET_MAX + 1];
+} SEM_SET;
+
 /**
  *  \brief Creation of a set of semaphores.
  *
@@ -58,6 +103,36 @@ extern int semConnect (int key);
 
 extern int semDestroy (int semgid);
 
+/**
+ *  \brief Destruction of a stale set of semaphores.
+ *
+ *  The set with a creation key equal to <tt>key</tt>, if any, is destroyed. It must be known to be stale: the
+ *  caller holds the shared memory block with the same key, so no simulation may be using the set.
+ *
+ *  \param key creation key
+ *
+ *  \return \c 1, if a set was destroyed
+ *  \return \c 0, if there is no set with that key
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semReclaim (int key);
+
+/**
+ *  \brief Reset of a previously created set of semaphores.
+ *
+ *  All semaphores in the set, including the one used to signal the start of operations, are put back in
+ *  <em>red state</em>, so the set may be reused for a new simulation. No process may be using the set.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semReset (int semgid);
+
 /**
  *  \brief Signalling start of operations upon initialization of shared data structures.
  *
@@ -99,4 +174,99 @@ extern int semDown (int semgid, unsigned int sindex);
 
 extern int semUp (int semgid, unsigned int sindex);
 
+/**
+ *  \brief <em>Down</em> of a semaphore within the set by <tt>n</tt> units.
+ *
+ *  A single operation is carried out: the process blocks until the semaphore value is at least <tt>n</tt>.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semDownN (int semgid, unsigned int sindex, unsigned int n);
+
+/**
+ *  \brief <em>Up</em> of a semaphore within the set by <tt>n</tt> units.
+ *
+ *  A single operation is carried out, equivalent to <tt>n</tt> consecutive <em>up</em>s.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semUpN (int semgid, unsigned int sindex, unsigned int n);
+
+/**
+ *  \brief Atomic execution of an array of operations on semaphores within the set.
+ *
+ *  Either all operations are carried out or the process blocks until they all can be.
+ *  The futex implementation has no way of blocking on several semaphores at once: it only carries out arrays of
+ *  <em>up</em>s (one at a time, which no <em>down</em> or <em>up</em> of a single semaphore can tell apart from
+ *  all at once) and arrays of a single operation; any other array fails with EINVAL.
+ *  <tt>sem_num</tt> of each operation is the semaphore location in the set (1 .. snum), <tt>sem_op</tt> the
+ *  (signed) number of units and <tt>sem_flg</tt> is usually 0.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param ops array of operations
+ *  \param nops number of operations in the array (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semOps (int semgid, struct sembuf *ops, unsigned int nops);
+
+/**
+ *  \brief Reading of the values of the semaphores of the set.
+ *
+ *  The values of locations 0 (start of operations) .. <tt>n</tt> - 1 are stored in <tt>val</tt>, as many as there are.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param val array where the values are stored
+ *  \param n number of entries of val
+ *
+ *  \return number of semaphores in the set (including location 0), upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semValues (int semgid, unsigned int *val, unsigned int n);
+
+/**
+ *  \brief Name of the semaphore implementation selected at build time (<tt>"sysv"</tt> or <tt>"futex"</tt>).
+ *
+ *  \return implementation name
+ */
+
+extern const char *semBackend (void);
+
+/**
+ *  \brief Printing of the latency statistics of the semaphores.
+ *
+ *  For each semaphore location and kind of time (wait in <em>down</em>, hold from a <em>down</em> to the next
+ *  <em>up</em> by the same process) the count, median, 99th percentile and maximum (ns) are printed.
+ *  Nothing is printed unless the implementation is compiled with <tt>SEM_STATS</tt> (<tt>make stats</tt>).
+ *
+ *  \param semgid set identifier
+ *  \param name names of the semaphore locations (NULL entries, or locations beyond nNames, are numbered)
+ *  \param nNames number of entries of name
+ *  \param fp stream the statistics are printed to
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int semStatDump (int semgid, const char *name[], unsigned int nNames, FILE *fp);
+
 #endif /* SEMAPHORE_H_ */
@@ -0,0 +1,446 @@
+/**
+ *  \file semaphoreFutex.c (implementation file)
+ *
+ *  \brief Semaphore management.
+ *
+ *  Futex based implementation of the interface defined in semaphore.h, selected at build time with
+ *  <tt>make SEM_BACKEND=futex</tt>.
+ *
+ *  The semaphore values are 32 bit words at the start of the shared memory block with the same creation key
+ *  (a SEM_SET, see semaphore.h), so there is no IPC object to reclaim besides the block itself and the set
+ *  identifier is the block identifier. <em>Down</em> and <em>up</em> of an uncontended semaphore are a single
+ *  atomic operation in user space; the kernel is only entered to block or to wake up blocked processes.
+ *
+ *  Operations defined on semaphores:
+ *     \li creation of a set of semaphores
+ *     \li connection to a previously created set of semaphores
+ *     \li destruction of a previously created set of semaphores
+ *     \li signalling start of operations
+ *     \li <em>down</em> of a semaphore within the set
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li <em>down</em> of a semaphore within the set by more than one unit
+ *     \li <em>up</em> of a semaphore within the set by more than one unit
+ *     \li execution of an array of <em>up</em>s of semaphores within the set.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/sem.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <assert.h>
+
+#include "semaphore.h"
+#include "sharedMemory.h"
+#include "trace.h"
+
+/** \brief identifier of the set mapped by this process */
+static int setId = -1;
+
+/** \brief local address of the set mapped by this process */
+static SEM_SET *set = NULL;
+
+/* internal functions */
+
+static long futex (unsigned int *uaddr, int op, unsigned int val)
+{
+  return syscall (SYS_futex, uaddr, op, val, NULL, NULL, 0);
+}
+
+/** \brief map the block of the set with identifier <tt>semgid</tt>, if not already mapped */
+static SEM_SET *getSet (int semgid)
+{
+  void *add;
+
+  if (semgid != setId)
+     { if (shmemAttach (semgid, &add) != 0)
+          return NULL;
+       if (set != NULL)
+          shmemDettach (set);
+       set = (SEM_SET *) add;
+       setId = semgid;
+     }
+  return set;
+}
+
+static int fsemDown (FSEM *s, unsigned int n)
+{
+  unsigned int v;
+
+  for (;;)
+  { v = __atomic_load_n (&s->val, __ATOMIC_RELAXED);
+    if (v >= n)
+       { if (__atomic_compare_exchange_n (&s->val, &v, v - n, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            return 0;
+         continue;
+       }
+    if (n > 1)
+       __atomic_fetch_add (&s->multi, 1, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add (&s->waiters, 1, __ATOMIC_SEQ_CST);
+    if ((futex (&s->val, FUTEX_WAIT, v) == -1) && (errno != EAGAIN) && (errno != EINTR))
+       { __atomic_fetch_sub (&s->waiters, 1, __ATOMIC_RELAXED);
+         if (n > 1)
+            __atomic_fetch_sub (&s->multi, 1, __ATOMIC_RELAXED);
+         return -1;
+       }
+    __atomic_fetch_sub (&s->waiters, 1, __ATOMIC_RELAXED);
+    if (n > 1)
+       __atomic_fetch_sub (&s->multi, 1, __ATOMIC_RELAXED);
+  }
+}
+
+static int fsemUp (FSEM *s, unsigned int n)
+{
+  __atomic_fetch_add (&s->val, n, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n (&s->waiters, __ATOMIC_SEQ_CST) > 0)
+     { /* when every blocked process waits for one unit, waking up n of them suffices */
+       if (futex (&s->val, FUTEX_WAKE, (__atomic_load_n (&s->multi, __ATOMIC_SEQ_CST) > 0) ? INT_MAX : n) == -1)
+          return -1;
+     }
+  return 0;
+}
+
+/* a single operation, or ups only (see semOps) */
+static int fsemOps (struct sembuf *ops, unsigned int nops)
+{
+  unsigned int i;
+
+  if ((nops == 1) && (ops[0].sem_op < 0))
+     return fsemDown (&set->sem[ops[0].sem_num], -ops[0].sem_op);
+  for (i = 0; i < nops; i++)
+    if (fsemUp (&set->sem[ops[i].sem_num], ops[i].sem_op) == -1)
+       return -1;
+  return 0;
+}
+
+/* external functions */
+
+/**
+ *  \brief Creation of a set of semaphores.
+ *
+ *  All semaphores in the set will be in set to <em>red state</em> upon creation.
+ *  The set takes the start of the shared memory block with a creation key equal to <tt>key</tt>.
+ *  The function fails if there is no such block, or if <tt>snum</tt> is larger than SEM_SET_MAX (EINVAL).
+ *
+ *  \param key creation key
+ *  \param snum number of semaphores in the set (1 .. SEM_SET_MAX)
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semCreate (int key, unsigned int snum)
+{
+  int semgid;                                                                            /* semaphore set identifier */
+  unsigned int i;
+
+  if (snum > SEM_SET_MAX)
+     { errno = EINVAL;
+       return -1;
+     }
+  if ((semgid = shmemConnect (key)) == -1)
+     return -1;
+  if (getSet (semgid) == NULL)
+     return -1;
+  set->snum = snum + 1;
+  for (i = 0; i <= snum; i++)
+  { set->sem[i].val = 0;
+    set->sem[i].waiters = 0;
+    set->sem[i].multi = 0;
+  }
+  return semgid;
+}
+
+/**
+ *  \brief Connection to a previously created set of semaphores.
+ *
+ *  The function fails if there is no shared memory block with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semConnect (int key)
+{
+  int semgid;                                                                            /* semaphore set identifier */
+
+  if ((semgid = shmemConnect (key)) == -1)
+     return -1;
+  if (getSet (semgid) == NULL)
+     return -1;
+  if ((fsemDown (&set->sem[0], 1) == -1) || (fsemUp (&set->sem[0], 1) == -1))   /* wait for start of operations */
+     return -1;
+  return semgid;
+}
+
+/**
+ *  \brief Destruction of a previously created set of semaphores.
+ *
+ *  The block of the set is only unmapped off the address space of the process: the set goes away with the
+ *  block, when it is destroyed (shmemDestroy).
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDestroy (int semgid)
+{
+  int ret = 0;
+
+  if (semgid == setId)
+     { ret = shmemDettach (set);
+       set = NULL;
+       setId = -1;
+     }
+  return ret;
+}
+
+/**
+ *  \brief Destruction of a stale set of semaphores.
+ *
+ *  The set lives in the shared memory block with the same key, which is reclaimed with the block
+ *  (shmemReclaim): nothing is left behind by itself.
+ *
+ *  \param key creation key
+ *
+ *  \return \c 0
+ */
+
+int semReclaim (int key)
+{
+  (void) key;
+  return 0;
+}
+
+/**
+ *  \brief Reset of a previously created set of semaphores.
+ *
+ *  All semaphores in the set, including the one used to signal the start of operations, are put back in
+ *  <em>red state</em>, so the set may be reused for a new simulation. No process may be using the set.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semReset (int semgid)
+{
+  unsigned int i;
+
+  if (getSet (semgid) == NULL)
+     return -1;
+  for (i = 0; i < set->snum; i++)
+  { set->sem[i].val = 0;
+    set->sem[i].waiters = 0;
+    set->sem[i].multi = 0;
+  }
+  return 0;
+}
+
+/**
+ *  \brief Signalling start of operations upon initialization of shared data structures.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semSignal (int semgid)
+{
+  if (getSet (semgid) == NULL)
+     return -1;
+  return fsemUp (&set->sem[0], 1);
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDown (int semgid, unsigned int sindex)
+{
+  assert(sindex>0);
+  if (getSet (semgid) == NULL)
+     return -1;
+  assert(sindex<set->snum);
+  return TRACED (TRACE_DOWN, sindex, fsemDown (&set->sem[sindex], 1));
+}
+
+/**
+ *  \brief <em>Up</em> of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semUp (int semgid, unsigned int sindex)
+{
+  assert(sindex>0);
+  if (getSet (semgid) == NULL)
+     return -1;
+  assert(sindex<set->snum);
+  return TRACED (TRACE_UP, sindex, fsemUp (&set->sem[sindex], 1));
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set by <tt>n</tt> units.
+ *
+ *  The process blocks until the semaphore value is at least <tt>n</tt>.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDownN (int semgid, unsigned int sindex, unsigned int n)
+{
+  assert(sindex>0);
+  assert(n>0);
+  if (getSet (semgid) == NULL)
+     return -1;
+  assert(sindex<set->snum);
+  return TRACED (TRACE_DOWN, sindex, fsemDown (&set->sem[sindex], n));
+}
+
+/**
+ *  \brief <em>Up</em> of a semaphore within the set by <tt>n</tt> units.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semUpN (int semgid, unsigned int sindex, unsigned int n)
+{
+  assert(sindex>0);
+  assert(n>0);
+  if (getSet (semgid) == NULL)
+     return -1;
+  assert(sindex<set->snum);
+  return TRACED (TRACE_UP, sindex, fsemUp (&set->sem[sindex], n));
+}
+
+/**
+ *  \brief Execution of an array of operations on semaphores within the set.
+ *
+ *  A process can not block on several futexes at once, so the operations can not be carried out as a whole
+ *  like in the SVIPC implementation: the array is either a single operation or <em>up</em>s only, which are
+ *  carried out in array order (no operation on a single semaphore tells them apart from all at once).
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>, or with
+ *  EINVAL for any other array.
+ *
+ *  \param semgid set identifier
+ *  \param ops array of operations
+ *  \param nops number of operations in the array (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semOps (int semgid, struct sembuf *ops, unsigned int nops)
+{
+  unsigned int i;
+
+  if (getSet (semgid) == NULL)
+     return -1;
+  for (i = 0; i < nops; i++)
+  { assert((ops[i].sem_num>0) && (ops[i].sem_num<set->snum));
+    if ((ops[i].sem_op == 0) || ((ops[i].sem_op < 0) && (nops > 1)))
+       { errno = EINVAL;
+         return -1;
+       }
+  }
+  return TRACED (TRACE_OPS, ops[0].sem_num, fsemOps (ops, nops));
+}
+
+/**
+ *  \brief Reading of the values of the semaphores of the set.
+ *
+ *  The values of locations 0 (start of operations) .. <tt>n</tt> - 1 are stored in <tt>val</tt>, as many as there are.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param val array where the values are stored
+ *  \param n number of entries of val
+ *
+ *  \return number of semaphores in the set (including location 0), upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semValues (int semgid, unsigned int *val, unsigned int n)
+{
+  unsigned int i;
+
+  if (getSet (semgid) == NULL)
+     return -1;
+  for (i = 0; (i < n) && (i < set->snum); i++)
+    val[i] = __atomic_load_n (&set->sem[i].val, __ATOMIC_RELAXED);
+  return (int) set->snum;
+}
+
+/**
+ *  \brief Name of the semaphore implementation.
+ *
+ *  \return <tt>"futex"</tt>
+ */
+
+const char *semBackend (void)
+{
+  return "futex";
+}
+
+/**
+ *  \brief Printing of the latency statistics.
+ *
+ *  Only the SysV implementation compiled with <tt>SEM_STATS</tt> keeps statistics: nothing is printed.
+ *
+ *  \param semgid set identifier
+ *  \param name names of the semaphore locations
+ *  \param nNames number of entries of name
+ *  \param fp stream the statistics are printed to
+ *
+ *  \return \c 0
+ */
+
+int semStatDump (int semgid, const char *name[], unsigned int nNames, FILE *fp)
+{
+  (void) semgid;
+  (void) name;
+  (void) nNames;
+  (void) fp;
+  return 0;
+}
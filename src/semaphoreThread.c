@@ -0,0 +1,478 @@
+/**
+ *  \file semaphoreThread.c (implementation file)
+ *
+ *  \brief Semaphore management.
+ *
+ *  Process-private implementation of the interface defined in semaphore.h, used by the thread engine
+ *  (probThreadSoccerGame), where the intervening entities are threads of a single process.
+ *
+ *  The sets live in the process heap and are found by their creation key in a table of the process; all
+ *  operations on a set are carried out under a pthread mutex of its own and each semaphore has a condition
+ *  variable on which the threads wait for it to be incremented.
+ *
+ *  Operations defined on semaphores:
+ *     \li creation of a set of semaphores
+ *     \li connection to a previously created set of semaphores
+ *     \li destruction of a previously created set of semaphores
+ *     \li reset of a previously created set of semaphores
+ *     \li signalling start of operations
+ *     \li <em>down</em> of a semaphore within the set
+ *     \li <em>up</em> of a semaphore within the set
+ *     \li <em>down</em> of a semaphore within the set by more than one unit
+ *     \li <em>up</em> of a semaphore within the set by more than one unit
+ *     \li execution of an array of operations on semaphores within the set.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/sem.h>
+#include <assert.h>
+
+#include "semaphore.h"
+#include "trace.h"
+
+/** \brief maximum number of sets in the process */
+#define  SET_MAX        64
+
+/**
+ *  \brief Definition of <em>process-private semaphore</em> data type.
+ */
+typedef struct {
+    /** \brief semaphore value */
+    unsigned int val;
+    /** \brief condition signalled when the value is incremented */
+    pthread_cond_t inc;
+} TSEM;
+
+/**
+ *  \brief Definition of <em>process-private semaphore set</em> data type.
+ */
+typedef struct {
+    /** \brief creation key */
+    int key;
+    /** \brief number of semaphores in the set (including the start of operations semaphore) */
+    unsigned int snum;
+    /** \brief access to the values of the set */
+    pthread_mutex_t lock;
+    /** \brief semaphores, location 0 is used to signal start of operations */
+    TSEM *sem;
+} TSEM_SET;
+
+/** \brief sets of the process, the set identifier is the position in the table */
+static TSEM_SET *sets[SET_MAX];
+
+/** \brief access to the table of sets */
+static pthread_mutex_t setsLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* internal functions */
+
+/** \brief set with identifier <tt>semgid</tt> (NULL, with errno set, if there is none) */
+static TSEM_SET *getSet (int semgid)
+{
+  TSEM_SET *set = NULL;
+
+  if ((semgid >= 0) && (semgid < SET_MAX))
+     { pthread_mutex_lock (&setsLock);
+       set = sets[semgid];
+       pthread_mutex_unlock (&setsLock);
+     }
+  if (set == NULL)
+     errno = EINVAL;
+  return set;
+}
+
+/** \brief all the <em>down</em>s of the array can be carried out now */
+static bool canDown (TSEM_SET *set, struct sembuf *ops, unsigned int nops, unsigned int *blocked)
+{
+  unsigned int i;
+
+  for (i = 0; i < nops; i++)
+    if ((ops[i].sem_op < 0) && (set->sem[ops[i].sem_num].val < (unsigned int) -ops[i].sem_op))
+       { *blocked = ops[i].sem_num;
+         return false;
+       }
+  return true;
+}
+
+/** \brief atomic execution of an array of operations (the set must be valid) */
+static int tsemOps (TSEM_SET *set, struct sembuf *ops, unsigned int nops)
+{
+  unsigned int i, blocked;
+
+  pthread_mutex_lock (&set->lock);
+  while (!canDown (set, ops, nops, &blocked))
+    pthread_cond_wait (&set->sem[blocked].inc, &set->lock);
+  for (i = 0; i < nops; i++)
+  { set->sem[ops[i].sem_num].val += ops[i].sem_op;
+    if (ops[i].sem_op > 0)
+       pthread_cond_broadcast (&set->sem[ops[i].sem_num].inc);
+  }
+  pthread_mutex_unlock (&set->lock);
+  return 0;
+}
+
+/* external functions */
+
+/**
+ *  \brief Creation of a set of semaphores.
+ *
+ *  All semaphores in the set will be in set to <em>red state</em> upon creation.
+ *  The function fails if there is already a semaphore set with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *  \param snum number of semaphores in the set (>= 1)
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semCreate (int key, unsigned int snum)
+{
+  TSEM_SET *set;                                                                                   /* the new set */
+  int semgid = -1, s;
+  unsigned int i;
+
+  if ((set = malloc (sizeof (TSEM_SET))) == NULL)
+     return -1;
+  if ((set->sem = malloc ((snum + 1) * sizeof (TSEM))) == NULL)
+     { free (set);
+       return -1;
+     }
+  set->key = key;
+  set->snum = snum + 1;
+  pthread_mutex_init (&set->lock, NULL);
+  for (i = 0; i <= snum; i++)
+  { set->sem[i].val = 0;
+    pthread_cond_init (&set->sem[i].inc, NULL);
+  }
+
+  pthread_mutex_lock (&setsLock);
+  for (s = 0; s < SET_MAX; s++)
+    if (sets[s] == NULL)
+       { if (semgid == -1) semgid = s; }
+       else if (sets[s]->key == key)
+               { semgid = -2;
+                 break;
+               }
+  if (semgid >= 0)
+     sets[semgid] = set;
+  pthread_mutex_unlock (&setsLock);
+
+  if (semgid < 0)
+     { errno = (semgid == -2) ? EEXIST : ENOSPC;
+       free (set->sem);
+       free (set);
+       return -1;
+     }
+  return semgid;
+}
+
+/**
+ *  \brief Connection to a previously created set of semaphores.
+ *
+ *  The function fails if there is no semaphore set with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *
+ *  \return set identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semConnect (int key)
+{
+  struct sembuf init[2] = {{ 0, -1, 0 }, {0, 1, 0}};                                     /* initialization operation */
+  int semgid = -1, s;
+
+  pthread_mutex_lock (&setsLock);
+  for (s = 0; s < SET_MAX; s++)
+    if ((sets[s] != NULL) && (sets[s]->key == key))
+       { semgid = s;
+         break;
+       }
+  pthread_mutex_unlock (&setsLock);
+
+  if (semgid == -1)
+     { errno = ENOENT;
+       return -1;
+     }
+  tsemOps (sets[semgid], init, 1);                                                  /* wait for start of operations */
+  tsemOps (sets[semgid], init + 1, 1);
+  return semgid;
+}
+
+/**
+ *  \brief Destruction of a previously created set of semaphores.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDestroy (int semgid)
+{
+  TSEM_SET *set;
+  unsigned int i;
+
+  if ((set = getSet (semgid)) == NULL)
+     return -1;
+  pthread_mutex_lock (&setsLock);
+  sets[semgid] = NULL;
+  pthread_mutex_unlock (&setsLock);
+  for (i = 0; i < set->snum; i++)
+    pthread_cond_destroy (&set->sem[i].inc);
+  pthread_mutex_destroy (&set->lock);
+  free (set->sem);
+  free (set);
+  return 0;
+}
+
+/**
+ *  \brief Destruction of a stale set of semaphores.
+ *
+ *  The sets do not outlive the process, so none is ever stale: nothing is done.
+ *
+ *  \param key creation key
+ *
+ *  \return \c 0
+ */
+
+int semReclaim (int key)
+{
+  (void) key;
+  return 0;
+}
+
+/**
+ *  \brief Reset of a previously created set of semaphores.
+ *
+ *  All semaphores in the set, including the one used to signal the start of operations, are put back in
+ *  <em>red state</em>, so the set may be reused for a new simulation. No process may be using the set.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semReset (int semgid)
+{
+  TSEM_SET *set;
+  unsigned int i;
+
+  if ((set = getSet (semgid)) == NULL)
+     return -1;
+  pthread_mutex_lock (&set->lock);
+  for (i = 0; i < set->snum; i++)
+    set->sem[i].val = 0;
+  pthread_mutex_unlock (&set->lock);
+  return 0;
+}
+
+/**
+ *  \brief Signalling start of operations upon initialization of shared data structures.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semSignal (int semgid)
+{
+  struct sembuf up = { 0, 1, 0 };                                                         /* all around up operation */
+  TSEM_SET *set;
+
+  if ((set = getSet (semgid)) == NULL)
+     return -1;
+  return tsemOps (set, &up, 1);
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDown (int semgid, unsigned int sindex)
+{
+  return semDownN (semgid, sindex, 1);
+}
+
+/**
+ *  \brief <em>Up</em> of a semaphore within the set.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semUp (int semgid, unsigned int sindex)
+{
+  return semUpN (semgid, sindex, 1);
+}
+
+/**
+ *  \brief <em>Down</em> of a semaphore within the set by more than one unit.
+ *
+ *  The process blocks until the semaphore value is at least <tt>n</tt> and then decrements it by <tt>n</tt>.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semDownN (int semgid, unsigned int sindex, unsigned int n)
+{
+  struct sembuf down = { 0, 0, 0 };                                                       /* specific down operation */
+  TSEM_SET *set;
+
+  assert(sindex>0);
+  assert(n>0);
+  if ((set = getSet (semgid)) == NULL)
+     return -1;
+  assert(sindex<set->snum);
+  down.sem_num = (unsigned short) sindex;
+  down.sem_op = -(short) n;
+  return TRACED (TRACE_DOWN, sindex, tsemOps (set, &down, 1));
+}
+
+/**
+ *  \brief <em>Up</em> of a semaphore within the set by more than one unit.
+ *
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param sindex semaphore location in the set (1 .. snum)
+ *  \param n number of units (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semUpN (int semgid, unsigned int sindex, unsigned int n)
+{
+  struct sembuf up = { 0, 0, 0 };                                                           /* specific up operation */
+  TSEM_SET *set;
+
+  assert(sindex>0);
+  assert(n>0);
+  if ((set = getSet (semgid)) == NULL)
+     return -1;
+  assert(sindex<set->snum);
+  up.sem_num = (unsigned short) sindex;
+  up.sem_op = (short) n;
+  return TRACED (TRACE_UP, sindex, tsemOps (set, &up, 1));
+}
+
+/**
+ *  \brief Atomic execution of an array of operations on semaphores within the set.
+ *
+ *  Either all operations are carried out or the thread blocks until they all can be.
+ *  <tt>sem_num</tt> of each operation is the semaphore location in the set (1 .. snum), <tt>sem_op</tt> the
+ *  (signed) number of units and <tt>sem_flg</tt> is ignored.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param ops array of operations
+ *  \param nops number of operations in the array (>= 1)
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semOps (int semgid, struct sembuf *ops, unsigned int nops)
+{
+  TSEM_SET *set;
+  unsigned int i;
+
+  if ((set = getSet (semgid)) == NULL)
+     return -1;
+  for (i = 0; i < nops; i++)
+    assert((ops[i].sem_num>0) && (ops[i].sem_num<set->snum));
+  return TRACED (TRACE_OPS, ops[0].sem_num, tsemOps (set, ops, nops));
+}
+
+/**
+ *  \brief Reading of the values of the semaphores of the set.
+ *
+ *  The values of locations 0 (start of operations) .. <tt>n</tt> - 1 are stored in <tt>val</tt>, as many as there are.
+ *  The function fails if there is no semaphore set with an identifier equal to <tt>semgid</tt>.
+ *
+ *  \param semgid set identifier
+ *  \param val array where the values are stored
+ *  \param n number of entries of val
+ *
+ *  \return number of semaphores in the set (including location 0), upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int semValues (int semgid, unsigned int *val, unsigned int n)
+{
+  TSEM_SET *set;
+  unsigned int i;
+
+  if ((set = getSet (semgid)) == NULL)
+     return -1;
+  pthread_mutex_lock (&set->lock);
+  for (i = 0; (i < n) && (i < set->snum); i++)
+    val[i] = set->sem[i].val;
+  pthread_mutex_unlock (&set->lock);
+  return (int) set->snum;
+}
+
+/**
+ *  \brief Name of the semaphore implementation.
+ *
+ *  \return <tt>"thread"</tt>
+ */
+
+const char *semBackend (void)
+{
+  return "thread";
+}
+
+/**
+ *  \brief Printing of the latency statistics.
+ *
+ *  Only the SysV implementation compiled with <tt>SEM_STATS</tt> keeps statistics: nothing is printed.
+ *
+ *  \param semgid set identifier
+ *  \param name names of the semaphore locations
+ *  \param nNames number of entries of name
+ *  \param fp stream the statistics are printed to
+ *
+ *  \return \c 0
+ */
+
+int semStatDump (int semgid, const char *name[], unsigned int nNames, FILE *fp)
+{
+  (void) semgid;
+  (void) name;
+  (void) nNames;
+  (void) fp;
+  return 0;
+}
@@ -17,15 +17,18 @@
 #ifndef SHAREDDATASYNC_H_
 #define SHAREDDATASYNC_H_
 
+#include <stddef.h>
+
 #include "probConst.h"
 #include "probDataStruct.h"
+#include "semaphore.h"
 
 /**
  *  \brief Definition of <em>shared information</em> data type.
  */
 typedef struct
-        { /** \brief full state of the problem */
-          FULL_STAT fSt;
+        { /** \brief semaphores of the futex implementation (must be the first member, see semaphore.h) */
+          SEM_SET sem;
 
           /* semaphores ids */
           /** \brief identification of critical region protection semaphore – val = 1 */
@@ -34,29 +37,101 @@ typedef struct
           unsigned int playersWaitTeam;
           /** \brief identification of semaphore used by goalies to wait for forming team teammate - val = 0 */
           unsigned int goaliesWaitTeam;
-          /** \brief identification of semaphore used by players and goalies to wait for the match to start - val = 0 */
-          unsigned int playersWaitReferee;
-          /** \brief identification of semaphore used by players and goalies to wait for the match to end - val = 0 */
-          unsigned int playersWaitEnd;
           /** \brief identification of semaphore used by referee to wait for teams to be formed – val = 0  */
           unsigned int refereeWaitTeams;
-          /** \brief identification of semaphore used by players and goalies to acknowledge team registration – val = 0  */
-          unsigned int playerRegistered;
-          /** \brief identification of semaphore used by referee to wait for players and goalies to start – val = 0  */
-          unsigned int playing;
+
+          /* teams */
+          /** \brief number of team slots */
+          int nTeamSlots;
+          /** \brief position in the queue of the next team to be matched to a referee (team id - 1 modulo the number
+                     of team slots) */
+          int queueHead;
+          /** \brief size of a team slot (in bytes) */
+          unsigned int teamStride;
+          /** \brief offset of the team slots from the start of the shared region */
+          size_t teamOff;
+          /** \brief offset of the queue of the formed teams (slot numbers, nTeamSlots entries, in the order of the team
+                     ids: TEAM_NOT_QUEUED until the team is complete) */
+          size_t queueOff;
+
+          /* reproducible games */
+          /** \brief seed of the random generators of the entities (0 if they are seeded by their pid) */
+          unsigned int seed;
+          /** \brief order of entry in the critical region */
+          REPLAY replay;
+
+          /** \brief name of the trace file of the entities (empty if the game is not traced) */
+          char trace[TRACE_NAME_LEN];
+
+          /** \brief size of the shared data type in the program that created the region */
+          unsigned int layout;
+
+          /** \brief size of the shared region (in bytes) */
+          size_t size;
+          /** \brief options of the shared region (SHMEM_HUGE, SHMEM_PREFAULT, SHMEM_LOCK) */
+          int shmem;
+
+          /** \brief metrics of the batch of games (kept from one game to the next) */
+          METRICS metrics CACHE_ALIGNED;
+
+          /** \brief log control block (mode and sequence number); the ring slots follow the full state */
+          LOG_BUF log CACHE_ALIGNED;
+
+          /** \brief full state of the problem (variable size, must be the last member) */
+          FULL_STAT fSt CACHE_ALIGNED;
 
         } SHARED_DATA;
 
+/** \brief number of IPC keys tried by a game process, from the ftok key up */
+#define KEY_RANGE                64
+
+/** \brief layout signature of the shared data type, checked by every program attaching to the region */
+#define SHARED_LAYOUT            ((unsigned int) sizeof (SHARED_DATA))
+
+/** \brief round <tt>n</tt> up to a multiple of <tt>a</tt> (a power of 2) */
+#define ROUND_UP(n,a)            (((n) + (a) - 1) & ~((size_t) (a) - 1))
+
+/** \brief size of a log ring slot (in bytes) */
+#define SLOT_SIZE(nP,nG,nR)      ROUND_UP (sizeof (LOG_SLOT) + STAT_SIZE (nP, nG, nR), _Alignof (LOG_SLOT))
+
+/** \brief offset of the log ring slots from the start of the shared region */
+#define RING_OFFSET(nP,nG,nR)    ROUND_UP (offsetof (SHARED_DATA, fSt.st) + STAT_SIZE (nP, nG, nR), CACHE_LINE)
+
+/** \brief offset of the last logged state (delta format) from the start of the shared region */
+#define LAST_OFFSET(nP,nG,nR)    (RING_OFFSET (nP, nG, nR) + LOG_RING_SIZE * SLOT_SIZE (nP, nG, nR))
+
+/** \brief offset of the team slots from the start of the shared region */
+#define TEAM_OFFSET(nP,nG,nR)    (LAST_OFFSET (nP, nG, nR) + ROUND_UP (STAT_SIZE (nP, nG, nR), CACHE_LINE))
+
+/** \brief size of a team slot for teams of <tt>nTP</tt> players and <tt>nTG</tt> goalies (in bytes) */
+#define TEAM_SIZE(nTP,nTG)       (sizeof (TEAM) + (size_t) ((nTP) + (nTG)) * sizeof (int))
+
+/** \brief team slot <tt>k</tt> */
+#define TEAM_SLOT(sh,k)          ((TEAM *) ((char *) (sh) + (sh)->teamOff + (size_t) (k) * (sh)->teamStride))
+
+/** \brief queue of the formed teams waiting for a referee */
+#define TEAM_QUEUE(sh)           ((int *) ((char *) (sh) + (sh)->queueOff))
+
+/** \brief log of the entries in the critical region */
+#define REPLAY_LOG(sh)           ((uint32_t *) ((char *) &(sh)->replay + (sh)->replay.entryOff))
+
+/* the segment layout must be the same for the three binaries */
+#ifdef COMPACT_STAT
+_Static_assert (sizeof (ENTITY_STAT) == 1, "compact entity state is a single byte");
+_Static_assert (offsetof (FULL_STAT, formation) % CACHE_LINE == 0, "counters start a cache line");
+_Static_assert (offsetof (FULL_STAT, st) % CACHE_LINE == 0, "entity states start a cache line");
+#endif
+_Static_assert (offsetof (SHARED_DATA, sem) == 0, "the futex semaphores start the shared region");
+_Static_assert (offsetof (SHARED_DATA, log) % CACHE_LINE == 0, "log control block starts a cache line");
+_Static_assert (offsetof (SHARED_DATA, fSt) % CACHE_LINE == 0, "full state starts a cache line");
+
 /** \brief number of semaphores in the set */
-#define SEM_NU                   8 
+#define SEM_NU                   4 
+_Static_assert (SEM_NU <= SEM_SET_MAX, "the semaphores fit the futex semaphore set");
 
 #define MUTEX                    1
 #define PLAYERSWAITTEAM          2
 #define GOALIESWAITTEAM          3
-#define PLAYERSWAITREFEREE       4
-#define PLAYERSWAITEND           5
-#define REFEREEWAITTEAMS         6
-#define PLAYERREGISTERED         7
-#define PLAYING                  8
+#define REFEREEWAITTEAMS         4
 
 #endif /* SHAREDDATASYNC_H_ */
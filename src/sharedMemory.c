@@ -8,18 +8,39 @@
  *      \li connection to a previously created block
  *      \li destruction of a previously created block
  *      \li mapping of the block previously created on the process address space
- *      \li unmapping of the block off the process address space.
+ *      \li unmapping of the block off the process address space
+ *      \li population of the pages of a mapped block.
  *
  *  \author António Rui Borges - October 1995
  */
 
 #include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
 #include <sys/types.h>
 #include <sys/shm.h>
+#include <sys/mman.h>
+
+#include "sharedMemory.h"
 
 /** \brief access permission: user r-w */
 #define  MASK           0600
 
+/** \brief options of the blocks created by the process */
+static int options = 0;
+
+/**
+ *  \brief Options of the blocks subsequently created by the process.
+ *
+ *  \param opts bitwise or of SHMEM_HUGE, SHMEM_PREFAULT and SHMEM_LOCK (0 by default)
+ */
+
+void shmemOptions (int opts)
+{
+  options = opts;
+}
+
 /**
  *  \brief Creation of a new block.
  *
@@ -34,7 +55,18 @@
 
 int shmemCreate (int key, unsigned int size)
 {
-  return shmget ((key_t) key, size, MASK | IPC_CREAT | IPC_EXCL);
+  int shmid, err;
+
+  if ((shmid = shmget ((key_t) key, size, MASK | IPC_CREAT | IPC_EXCL | ((options & SHMEM_HUGE) ? SHM_HUGETLB : 0)))
+      == -1)
+     return -1;
+  if ((options & SHMEM_LOCK) && (shmctl (shmid, SHM_LOCK, (struct shmid_ds *) NULL) == -1))
+     { err = errno;                                                         /* no CAP_IPC_LOCK, or RLIMIT_MEMLOCK */
+       shmctl (shmid, IPC_RMID, (struct shmid_ds *) NULL);
+       errno = err;
+       return -1;
+     }
+  return shmid;
 }
 
 /**
@@ -69,6 +101,35 @@ int shmemDestroy (int shmid)
   return shmctl (shmid, IPC_RMID, (struct shmid_ds *) NULL);
 }
 
+/**
+ *  \brief Destruction of a stale block.
+ *
+ *  A block with a creation key equal to <tt>key</tt> is stale when no process is attached to it and the process
+ *  that created it no longer exists (it was left behind by a crashed program); it is then destroyed.
+ *
+ *  \param key creation key
+ *
+ *  \return \c 1, if a stale block was destroyed
+ *  \return \c 0, if there is no block with that key
+ *  \return -\c 1, if the block is in use (<tt>errno</tt> is EBUSY) or when an error occurs
+ */
+
+int shmemReclaim (int key)
+{
+  struct shmid_ds ds;                                                                           /* block status */
+  int shmid;
+
+  if ((shmid = shmget ((key_t) key, 0, MASK)) == -1)
+     return (errno == ENOENT) ? 0 : -1;
+  if (shmctl (shmid, IPC_STAT, &ds) == -1)
+     return -1;
+  if ((ds.shm_nattch > 0) || (kill (ds.shm_cpid, 0) == 0) || (errno == EPERM))
+     { errno = EBUSY;
+       return -1;
+     }
+  return (shmctl (shmid, IPC_RMID, (struct shmid_ds *) NULL) == -1) ? -1 : 1;
+}
+
 /**
  *  \brief Mapping of the block previously created on the process address space.
  *
@@ -84,10 +145,16 @@ int shmemDestroy (int shmid)
 int shmemAttach (int shmid, void **pAttAdd)
 {
   void *add;                                                                                    /* temporary pointer */
+  struct shmid_ds ds;                                                                           /* block status */
 
   add = shmat (shmid, (char *) NULL, 0);
   if (add != (void *) -1)
-     { *pAttAdd = (void *) add;
+     { if ((options & SHMEM_PREFAULT) && ((shmctl (shmid, IPC_STAT, &ds) == -1) ||
+                                          (shmemPrefault (add, ds.shm_segsz) == -1)))
+          { shmdt (add);
+            return -1;
+          }
+       *pAttAdd = (void *) add;
        return 0;
      }
      else return 1;
@@ -109,3 +176,32 @@ int shmemDettach (void *attAdd)
 {
   return shmdt (attAdd);
 }
+
+/**
+ *  \brief Population of the pages of a mapped block.
+ *
+ *  The page table entries of the process are filled (and the pages allocated, if they were not yet), so that
+ *  its first accesses to the block do not fault. Each page is written by an atomic addition of zero where
+ *  MADV_POPULATE_WRITE is not available, so the data of the other processes is never changed.
+ *
+ *  \param attAdd local address of the attached block
+ *  \param size number of bytes populated from the start of the block
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemPrefault (void *attAdd, size_t size)
+{
+  size_t page = (size_t) sysconf (_SC_PAGESIZE), off;
+
+#ifdef MADV_POPULATE_WRITE
+  if (madvise (attAdd, size, MADV_POPULATE_WRITE) == 0)
+     return 0;
+  if (errno != EINVAL)                                                                 /* kernels before 5.14 */
+     return -1;
+#endif
+  for (off = 0; off < size; off += page)
+    __atomic_fetch_add ((char *) attAdd + off, 0, __ATOMIC_RELAXED);
+  return 0;
+}
@@ -8,7 +8,8 @@
  *      \li connection to a previously created block
  *      \li destruction of a previously created block
  *      \li mapping of the block previously created on the process address space
- *      \li unmapping of the block off the process address space.
+ *      \li unmapping of the block off the process address space
+ *      \li population of the pages of a mapped block.
  *
  *  \author António Rui Borges - October 1995
  */
@@ -16,6 +17,25 @@
 #ifndef SHAREDMEMORY_H_
 #define SHAREDMEMORY_H_
 
+#include <stddef.h>
+
+/* Options of the blocks created by the process (shmemOptions) */
+
+/** \brief block backed by huge pages (SysV: SHM_HUGETLB; POSIX and process-private: transparent huge pages) */
+#define  SHMEM_HUGE         1
+/** \brief pages populated when the block is created and when it is mapped by the creator (see shmemPrefault) */
+#define  SHMEM_PREFAULT     2
+/** \brief block locked in memory (SysV: SHM_LOCK; POSIX and process-private: mlock of the mapping) */
+#define  SHMEM_LOCK         4
+
+/**
+ *  \brief Options of the blocks subsequently created by the process.
+ *
+ *  \param options bitwise or of SHMEM_HUGE, SHMEM_PREFAULT and SHMEM_LOCK (0 by default)
+ */
+
+extern void shmemOptions (int options);
+
 /**
  *  \brief Creation of a new block.
  *
@@ -56,6 +76,21 @@ extern int shmemConnect (int key);
 
 extern int shmemDestroy (int shmid);
 
+/**
+ *  \brief Destruction of a stale block.
+ *
+ *  A block with a creation key equal to <tt>key</tt> is stale when no process is attached to it and the process
+ *  that created it no longer exists (it was left behind by a crashed program); it is then destroyed.
+ *
+ *  \param key creation key
+ *
+ *  \return \c 1, if a stale block was destroyed
+ *  \return \c 0, if there is no block with that key
+ *  \return -\c 1, if the block is in use (<tt>errno</tt> is EBUSY) or when an error occurs
+ */
+
+extern int shmemReclaim (int key);
+
 /**
  *  \brief Mapping of the block previously created on the process address space.
  *
@@ -84,4 +119,19 @@ extern int shmemAttach (int shmid, void **pAttAdd);
 
 extern int shmemDettach (void *attAdd);
 
+/**
+ *  \brief Population of the pages of a mapped block.
+ *
+ *  The page table entries of the process are filled (and the pages allocated, if they were not yet), so that
+ *  its first accesses to the block do not fault.
+ *
+ *  \param attAdd local address of the attached block
+ *  \param size number of bytes populated from the start of the block
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+extern int shmemPrefault (void *attAdd, size_t size);
+
 #endif /* SHAREDMEMORY_H_ */
@@ -0,0 +1,281 @@
+/**
+ *  \file sharedMemoryPosix.c (implementation file)
+ *
+ *  \brief Shared memory management.
+ *
+ *  POSIX implementation of the interface defined in sharedMemory.h, selected at build time with
+ *  <tt>make SHM_BACKEND=posix</tt>: a block is the shared memory object <tt>/soccerGame.key</tt>
+ *  (<tt>shm_open</tt>), mapped with <tt>mmap</tt>, and the block identifier is its creation key.
+ *
+ *  The object starts with a header holding the pid of the creator and the size of the mapping; the block
+ *  handed out by shmemAttach follows it, one cache line after the start of the mapping. There is no count of
+ *  the attached processes, so a block is stale as soon as its creator no longer exists.
+ *
+ *   Operations defined on shared memory:
+ *      \li creation of a new block
+ *      \li connection to a previously created block
+ *      \li destruction of a previously created block
+ *      \li mapping of the block previously created on the process address space
+ *      \li unmapping of the block off the process address space
+ *      \li population of the pages of a mapped block.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "sharedMemory.h"
+
+/** \brief access permission: user r-w */
+#define  MASK           0600
+
+/** \brief size of the header of the object (a cache line, the block keeps the alignment of the mapping) */
+#define  HEADER_SIZE    64
+
+/**
+ *  \brief Definition of <em>object header</em> data type.
+ */
+typedef struct {
+    /** \brief pid of the process that created the block */
+    pid_t cpid;
+    /** \brief size of the object (header and block, in bytes) */
+    size_t size;
+} HEADER;
+
+_Static_assert (sizeof (HEADER) <= HEADER_SIZE, "the header fits its cache line");
+
+/** \brief options of the blocks created and mapped by the process */
+static int options = 0;
+
+/** \brief name of the object of creation key <tt>key</tt> */
+static void objName (char *name, size_t size, int key)
+{
+  snprintf (name, size, "/soccerGame.%x", (unsigned int) key);
+}
+
+/**
+ *  \brief Options of the blocks subsequently created by the process.
+ *
+ *  \param opts bitwise or of SHMEM_HUGE, SHMEM_PREFAULT and SHMEM_LOCK (0 by default)
+ */
+
+void shmemOptions (int opts)
+{
+  options = opts;
+}
+
+/**
+ *  \brief Creation of a new block.
+ *
+ *  The function fails if there is already a block of shared memory with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *  \param size block size (in bytes)
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemCreate (int key, unsigned int size)
+{
+  char name[32];
+  HEADER h = { getpid (), HEADER_SIZE + (size_t) size };
+  int fd, err;
+
+  objName (name, sizeof (name), key);
+  if ((fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, MASK)) == -1)
+     return -1;
+  if ((ftruncate (fd, (off_t) h.size) == -1) || (pwrite (fd, &h, sizeof (h), 0) != (ssize_t) sizeof (h)))
+     { err = errno;
+       close (fd);
+       shm_unlink (name);
+       errno = err;
+       return -1;
+     }
+  close (fd);
+  return key;
+}
+
+/**
+ *  \brief Connection to a previously created block.
+ *
+ *  The function fails if there is no block with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemConnect (int key)
+{
+  char name[32];
+  int fd;
+
+  objName (name, sizeof (name), key);
+  if ((fd = shm_open (name, O_RDWR, MASK)) == -1)
+     return -1;
+  close (fd);
+  return key;
+}
+
+/**
+ *  \brief Destruction of a previously created block.
+ *
+ *  The name is removed at once; the memory is released when the last process unmaps it.
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>.
+ *
+ *  \param shmid block identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemDestroy (int shmid)
+{
+  char name[32];
+
+  objName (name, sizeof (name), shmid);
+  return shm_unlink (name);
+}
+
+/**
+ *  \brief Destruction of a stale block.
+ *
+ *  A block with a creation key equal to <tt>key</tt> is stale when the process that created it no longer exists
+ *  (it was left behind by a crashed program); it is then destroyed.
+ *
+ *  \param key creation key
+ *
+ *  \return \c 1, if a stale block was destroyed
+ *  \return \c 0, if there is no block with that key
+ *  \return -\c 1, if the block is in use (<tt>errno</tt> is EBUSY) or when an error occurs
+ */
+
+int shmemReclaim (int key)
+{
+  char name[32];
+  HEADER h = { 0, 0 };                                      /* a header not yet written: the block is being created */
+  int fd;
+
+  objName (name, sizeof (name), key);
+  if ((fd = shm_open (name, O_RDWR, MASK)) == -1)
+     return (errno == ENOENT) ? 0 : -1;
+  if (pread (fd, &h, sizeof (h), 0) == -1)
+     { close (fd);
+       return -1;
+     }
+  close (fd);
+  if ((h.cpid == 0) || (kill (h.cpid, 0) == 0) || (errno == EPERM))
+     { errno = EBUSY;
+       return -1;
+     }
+  return (shm_unlink (name) == -1) ? -1 : 1;
+}
+
+/**
+ *  \brief Mapping of the block previously created on the process address space.
+ *
+ *  The mapping is populated (MAP_POPULATE), transparent huge pages are requested for it and it is locked in
+ *  memory according to the options of the process.
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>.
+ *
+ *  \param shmid block identifier
+ *  \param pAttAdd pointer to the location where the local address of the attached block is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemAttach (int shmid, void **pAttAdd)
+{
+  char name[32];
+  struct stat st;
+  void *add;                                                                                    /* temporary pointer */
+  int fd, err;
+
+  objName (name, sizeof (name), shmid);
+  if ((fd = shm_open (name, O_RDWR, MASK)) == -1)
+     return -1;
+  if (fstat (fd, &st) == -1)
+     { err = errno;
+       close (fd);
+       errno = err;
+       return -1;
+     }
+  add = mmap (NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE,
+              MAP_SHARED | ((options & SHMEM_PREFAULT) ? MAP_POPULATE : 0), fd, 0);
+  err = errno;
+  close (fd);
+  if (add == MAP_FAILED)
+     { errno = err;
+       return -1;
+     }
+#ifdef MADV_HUGEPAGE
+  if (options & SHMEM_HUGE)
+     madvise (add, (size_t) st.st_size, MADV_HUGEPAGE);         /* a hint, honoured if shmem_enabled allows it */
+#endif
+  if ((options & SHMEM_LOCK) && (mlock (add, (size_t) st.st_size) == -1))
+     { err = errno;
+       munmap (add, (size_t) st.st_size);
+       errno = err;
+       return -1;
+     }
+  *pAttAdd = (char *) add + HEADER_SIZE;
+  return 0;
+}
+
+/**
+ *  \brief Unmapping of the block off the process address space.
+ *
+ *  The function fails if the pointer does not locate a region of the address space
+ *  where a mapping took previously place.
+ *
+ *  \param attAdd local address of the attached block
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemDettach (void *attAdd)
+{
+  HEADER *h = (HEADER *) ((char *) attAdd - HEADER_SIZE);
+
+  return munmap (h, h->size);
+}
+
+/**
+ *  \brief Population of the pages of a mapped block.
+ *
+ *  The page table entries of the process are filled (and the pages allocated, if they were not yet), so that
+ *  its first accesses to the block do not fault. Each page is written by an atomic addition of zero where
+ *  MADV_POPULATE_WRITE is not available, so the data of the other processes is never changed.
+ *
+ *  \param attAdd local address of the attached block
+ *  \param size number of bytes populated from the start of the block
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemPrefault (void *attAdd, size_t size)
+{
+  size_t page = (size_t) sysconf (_SC_PAGESIZE), off;
+
+#ifdef MADV_POPULATE_WRITE
+  char *start = (char *) attAdd - HEADER_SIZE;                                     /* madvise needs a page start */
+
+  if (madvise (start, size + HEADER_SIZE, MADV_POPULATE_WRITE) == 0)
+     return 0;
+  if (errno != EINVAL)                                                                 /* kernels before 5.14 */
+     return -1;
+#endif
+  for (off = 0; off < size; off += page)
+    __atomic_fetch_add ((char *) attAdd + off, 0, __ATOMIC_RELAXED);
+  return 0;
+}
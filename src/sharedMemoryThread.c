@@ -0,0 +1,258 @@
+/**
+ *  \file sharedMemoryThread.c (implementation file)
+ *
+ *  \brief Shared memory management.
+ *
+ *  Process-private implementation of the interface defined in sharedMemory.h, used by the thread engine
+ *  (probThreadSoccerGame): a block is a zero filled, cache line aligned, area of the process heap, found by its
+ *  creation key in a table of the process, and mapping it only returns its address.
+ *
+ *   Operations defined on shared memory:
+ *      \li creation of a new block
+ *      \li connection to a previously created block
+ *      \li destruction of a previously created block
+ *      \li mapping of the block previously created on the process address space
+ *      \li unmapping of the block off the process address space
+ *      \li population of the pages of a mapped block.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "sharedMemory.h"
+
+/** \brief maximum number of blocks in the process */
+#define  BLOCK_MAX      64
+
+/** \brief alignment of the blocks (a cache line, as the shared data type requires) */
+#define  BLOCK_ALIGN    64
+
+/** \brief alignment of the blocks backed by transparent huge pages (SHMEM_HUGE) */
+#define  HUGE_ALIGN     (2 * 1024 * 1024)
+
+/**
+ *  \brief Definition of <em>process-private block</em> data type.
+ */
+typedef struct {
+    /** \brief creation key */
+    int key;
+    /** \brief address of the block (NULL if the entry is free) */
+    void *add;
+} BLOCK;
+
+/** \brief blocks of the process, the block identifier is the position in the table */
+static BLOCK blocks[BLOCK_MAX];
+
+/** \brief access to the table of blocks */
+static pthread_mutex_t blocksLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief options of the blocks created by the process */
+static int options = 0;
+
+/**
+ *  \brief Options of the blocks subsequently created by the process.
+ *
+ *  The blocks are always populated, they are zero filled on creation.
+ *
+ *  \param opts bitwise or of SHMEM_HUGE, SHMEM_PREFAULT and SHMEM_LOCK (0 by default)
+ */
+
+void shmemOptions (int opts)
+{
+  options = opts;
+}
+
+/**
+ *  \brief Creation of a new block.
+ *
+ *  The function fails if there is already a block of shared memory with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *  \param size block size (in bytes)
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemCreate (int key, unsigned int size)
+{
+  void *add;                                                                                    /* temporary pointer */
+  int shmid = -1, b;
+
+  if ((errno = posix_memalign (&add, (options & SHMEM_HUGE) ? HUGE_ALIGN : BLOCK_ALIGN, size)) != 0)
+     return -1;
+#ifdef MADV_HUGEPAGE
+  if (options & SHMEM_HUGE)
+     madvise (add, size, MADV_HUGEPAGE);                       /* a hint, honoured if THP is enabled (madvise) */
+#endif
+  memset (add, 0, size);
+  if ((options & SHMEM_LOCK) && (mlock (add, size) == -1))
+     { free (add);
+       return -1;
+     }
+
+  pthread_mutex_lock (&blocksLock);
+  for (b = 0; b < BLOCK_MAX; b++)
+    if (blocks[b].add == NULL)
+       { if (shmid == -1) shmid = b; }
+       else if (blocks[b].key == key)
+               { shmid = -2;
+                 break;
+               }
+  if (shmid >= 0)
+     { blocks[shmid].key = key;
+       blocks[shmid].add = add;
+     }
+  pthread_mutex_unlock (&blocksLock);
+
+  if (shmid < 0)
+     { errno = (shmid == -2) ? EEXIST : ENOSPC;
+       free (add);
+       return -1;
+     }
+  return shmid;
+}
+
+/**
+ *  \brief Connection to a previously created block.
+ *
+ *  The function fails if there is no block with a creation key equal to <tt>key</tt>.
+ *
+ *  \param key creation key
+ *
+ *  \return block identifier, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemConnect (int key)
+{
+  int shmid = -1, b;
+
+  pthread_mutex_lock (&blocksLock);
+  for (b = 0; b < BLOCK_MAX; b++)
+    if ((blocks[b].add != NULL) && (blocks[b].key == key))
+       { shmid = b;
+         break;
+       }
+  pthread_mutex_unlock (&blocksLock);
+
+  if (shmid == -1)
+     errno = ENOENT;
+  return shmid;
+}
+
+/**
+ *  \brief Destruction of a previously created block.
+ *
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>.
+ *
+ *  \param shmid block identifier
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemDestroy (int shmid)
+{
+  void *add = NULL;
+
+  pthread_mutex_lock (&blocksLock);
+  if ((shmid >= 0) && (shmid < BLOCK_MAX))
+     { add = blocks[shmid].add;
+       blocks[shmid].add = NULL;
+     }
+  pthread_mutex_unlock (&blocksLock);
+
+  if (add == NULL)
+     { errno = EINVAL;
+       return -1;
+     }
+  free (add);
+  return 0;
+}
+
+/**
+ *  \brief Destruction of a stale block.
+ *
+ *  The blocks do not outlive the process, so none is ever stale: a block with that key is in use.
+ *
+ *  \param key creation key
+ *
+ *  \return \c 0, if there is no block with that key
+ *  \return -\c 1, if the block is in use (<tt>errno</tt> is EBUSY)
+ */
+
+int shmemReclaim (int key)
+{
+  if (shmemConnect (key) == -1)
+     return 0;
+  errno = EBUSY;
+  return -1;
+}
+
+/**
+ *  \brief Mapping of the block previously created on the process address space.
+ *
+ *  The function fails if there is no block with an identifier equal to <tt>shmid</tt>.
+ *
+ *  \param shmid block identifier
+ *  \param pAttAdd pointer to the location where the local address of the attached block is stored
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemAttach (int shmid, void **pAttAdd)
+{
+  void *add = NULL;                                                                             /* temporary pointer */
+
+  pthread_mutex_lock (&blocksLock);
+  if ((shmid >= 0) && (shmid < BLOCK_MAX))
+     add = blocks[shmid].add;
+  pthread_mutex_unlock (&blocksLock);
+
+  if (add == NULL)
+     { errno = EINVAL;
+       return -1;
+     }
+  *pAttAdd = add;
+  return 0;
+}
+
+/**
+ *  \brief Unmapping of the block off the process address space.
+ *
+ *  Nothing is done, the block stays in the process heap until it is destroyed.
+ *
+ *  \param attAdd local address of the attached block
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemDettach (void *attAdd)
+{
+  return (attAdd == NULL) ? -1 : 0;
+}
+
+/**
+ *  \brief Population of the pages of a mapped block.
+ *
+ *  Nothing is done, the block was zero filled on creation and is mapped by all the threads.
+ *
+ *  \param attAdd local address of the attached block
+ *  \param size number of bytes populated from the start of the block
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+
+int shmemPrefault (void *attAdd, size_t size)
+{
+  (void) size;
+  return (attAdd == NULL) ? -1 : 0;
+}
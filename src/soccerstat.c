@@ -0,0 +1,145 @@
+/**
+ *  \file soccerstat.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Live metrics of the running games.
+ *
+ *  Read-only observer: every interval it attaches to the shared region of each game process running in the
+ *  present directory (the KEY_RANGE keys from <tt>ftok (".", 'a')</tt> up), reads its metrics block without
+ *  taking the mutex (see METRICS) and prints one line per game process, with the totals and the rates since the
+ *  previous reading:
+ *     \li games played and matches refereed to the end, teams formed, players and goalies late
+ *     \li waits on the semaphores and barriers besides the mutex (average wait)
+ *     \li entries in the critical region, the fraction of them that had to wait for the mutex (contended) and
+ *         the average wait for the mutex.
+ *
+ *  A region is detached after each reading, so the game processes started during a batch sweep are found and
+ *  the regions of the ended ones are not kept. The thread engine keeps its region in the memory of the process
+ *  and cannot be observed.
+ *
+ *  Upon execution, the following options are accepted:
+ *    \li <tt>-i ms</tt>: interval between readings (default 1000)
+ *    \li <tt>-c n</tt>: number of readings (default 0, until interrupted).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+#include "sharedMemory.h"
+#include "metrics.h"
+
+/** \brief counters of the previous reading of each key */
+static uint64_t prev[KEY_RANGE][METRIC_NUM];
+
+/** \brief region of the previous reading of each key (-1 if none) */
+static int prevShmid[KEY_RANGE];
+
+/** \brief rate of a counter since the previous reading (per second) */
+static double rate (const uint64_t *count, int k, int c, double s)
+{
+    return (count[c] - prev[k][c]) / s;
+}
+
+/** \brief average of a time counter per event since the previous reading (us; 0 without events) */
+static double avg (const uint64_t *count, int k, int cNs, int cEvents)
+{
+    uint64_t n = count[cEvents] - prev[k][cEvents];
+
+    return (n == 0) ? 0.0 : (count[cNs] - prev[k][cNs]) / 1e3 / n;
+}
+
+/** \brief read and print the metrics of the game process of key <tt>base + k</tt>, if any */
+static bool report (int base, int k, double s)
+{
+    uint64_t count[METRIC_NUM];
+    SHARED_DATA *sh;
+    uint64_t entries;
+    int shmid, c;
+    bool ok;
+
+    if ((shmid = shmemConnect (base + k)) == -1) {
+        prevShmid[k] = -1;
+        return false;
+    }
+    if (shmemAttach (shmid, (void **) &sh) != 0) {
+        return false;
+    }
+    ok = (sh->layout == SHARED_LAYOUT) && (metricsRead (&sh->metrics, count) == 0);   /* initialized by its game */
+    shmemDettach (sh);
+    if (!ok) {
+        return false;
+    }
+    if (prevShmid[k] != shmid) {                                         /* a new game process: no rates yet */
+        for (c = 0; c < METRIC_NUM; c++) {
+            prev[k][c] = count[c];
+        }
+        prevShmid[k] = shmid;
+    }
+
+    entries = count[METRIC_ENTRIES] - prev[k][METRIC_ENTRIES];
+    printf ("key 0x%08x  games %6lu %6.1f/s  matches %7lu %7.1f/s  teams %7lu %7.1f/s  late %6lu  "
+            "waits %8.1f/s %9.1f us  region %9.1f/s %5.1f%% contended %7.2f us\n", base + k,
+            count[METRIC_GAMES], rate (count, k, METRIC_GAMES, s), count[METRIC_MATCHES],
+            rate (count, k, METRIC_MATCHES, s), count[METRIC_TEAMS], rate (count, k, METRIC_TEAMS, s),
+            count[METRIC_LATE], rate (count, k, METRIC_WAITS, s), avg (count, k, METRIC_WAIT_NS, METRIC_WAITS),
+            rate (count, k, METRIC_ENTRIES, s),
+            (entries == 0) ? 0.0 : 100.0 * (count[METRIC_CONTENDED] - prev[k][METRIC_CONTENDED]) / entries,
+            avg (count, k, METRIC_MUTEX_NS, METRIC_ENTRIES));
+    for (c = 0; c < METRIC_NUM; c++) {
+        prev[k][c] = count[c];
+    }
+    return true;
+}
+
+int main (int argc, char *argv[])
+{
+    int interval = 1000, nReadings = 0, reading, base, k, found, opt;
+
+    while ((opt = getopt (argc, argv, "i:c:")) != -1) {
+        switch (opt) {
+            case 'i':
+                interval = atoi (optarg);
+                break;
+            case 'c':
+                nReadings = atoi (optarg);
+                break;
+            default:
+                fprintf (stderr, "Usage: %s [-i ms] [-c readings]\n", argv[0]);
+                exit (EXIT_FAILURE);
+        }
+    }
+    if (interval <= 0) {
+        fprintf (stderr, "The interval must be positive\n");
+        exit (EXIT_FAILURE);
+    }
+    if ((base = ftok (".", 'a')) == -1) {
+        perror ("error on generating the key");
+        exit (EXIT_FAILURE);
+    }
+    for (k = 0; k < KEY_RANGE; k++) {
+        prevShmid[k] = -1;
+    }
+
+    for (reading = 0; (nReadings == 0) || (reading < nReadings); reading++) {
+        if (reading > 0) {
+            usleep (interval * 1000);
+        }
+        for (k = found = 0; k < KEY_RANGE; k++) {
+            found += report (base, k, interval / 1e3);
+        }
+        if (found == 0) {
+            printf ("no game running\n");
+        }
+        fflush (stdout);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+/**
+ *  \file state.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief State machines of the intervening entities.
+ *
+ *  The state table of the interface defined in state.h. Players and goalies share one state machine; in
+ *  tournament mode they go back to the formation of a team after each match, and the referees back to the wait
+ *  for teams.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "metrics.h"
+#include "state.h"
+
+/** \brief list of the states from which a state may be entered */
+#define  FROM(...)          ((const char []) { __VA_ARGS__, '\0' })
+
+/** \brief states of a player or goalie (a team member) */
+#define  MEMBER_STATES                                                                                              \
+    [ARRIVING]        = { "A arriving",               STATE_NO_METRIC, FROM (ARRIVING),                              \
+                          STATE_SYNC_NONE },                                                                         \
+    [WAITING_TEAM]    = { "W waiting team",           STATE_NO_METRIC, FROM (ARRIVING, PLAYING_1, PLAYING_2),        \
+                          STATE_SYNC_NONE },                                                                         \
+    [FORMING_TEAM]    = { "F forming team",           STATE_NO_METRIC, FROM (ARRIVING, PLAYING_1, PLAYING_2),        \
+                          STATE_SYNC_NONE },                                                                         \
+    [WAITING_START_1] = { "s waiting start (team 1)", STATE_NO_METRIC, FROM (WAITING_TEAM, FORMING_TEAM),            \
+                          STATE_SYNC_TEAM },                                          /* waits for the referee */    \
+    [WAITING_START_2] = { "S waiting start (team 2)", STATE_NO_METRIC, FROM (WAITING_TEAM, FORMING_TEAM),            \
+                          STATE_SYNC_TEAM },                                                                         \
+    [PLAYING_1]       = { "p playing (team 1)",       STATE_NO_METRIC, FROM (WAITING_START_1),                       \
+                          STATE_SYNC_TEAM },                                          /* until the referee ends */   \
+    [PLAYING_2]       = { "P playing (team 2)",       STATE_NO_METRIC, FROM (WAITING_START_2),                       \
+                          STATE_SYNC_TEAM },                                                                         \
+    [LATE]            = { "L late",                   METRIC_LATE,     FROM (ARRIVING, PLAYING_1, PLAYING_2,         \
+                                                                             WAITING_TEAM, FORMING_TEAM),            \
+                          STATE_SYNC_NONE }
+
+const STATE_DEF stateTable[STATE_TYPES][STATE_CODES] = {
+    [STATE_PLAYER]  = { MEMBER_STATES },
+    [STATE_GOALIE]  = { MEMBER_STATES },
+    [STATE_REFEREE] = {
+        [ARRIVINGR]     = { "A arriving",      STATE_NO_METRIC, FROM (ARRIVINGR),                STATE_SYNC_NONE },
+        [WAITING_TEAMS] = { "W waiting teams", STATE_NO_METRIC, FROM (ARRIVINGR, ENDING_GAME),   STATE_SYNC_NONE },
+        [STARTING_GAME] = { "S starting game", STATE_NO_METRIC, FROM (WAITING_TEAMS),            STATE_SYNC_MATCH },
+        [REFEREEING]    = { "R refereeing",    STATE_NO_METRIC, FROM (STARTING_GAME),            STATE_SYNC_NONE },
+        [ENDING_GAME]   = { "E ending game",   METRIC_MATCHES,  FROM (REFEREEING),               STATE_SYNC_END }
+    }
+};
+
+const char *const stateTag[STATE_TYPES] = { "PL", "GL", "RF" };
+
+const char *stateName (int type, unsigned int state)
+{
+    const char *name = (state < STATE_CODES) ? stateTable[type][state].name : NULL;
+
+    return (name != NULL) ? name : "?";
+}
@@ -0,0 +1,247 @@
+/**
+ *  \file state.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief State machines of the intervening entities.
+ *
+ *  The states of players, goalies and referees (probConst.h) and the transitions between them are defined once,
+ *  in a table indexed by the entity type and the state (state.c): each state lists the states an entity may
+ *  leave to enter it, the metrics counter its entry adds to (METRIC_LATE, METRIC_MATCHES), if any, and the
+ *  synchronization the entity carries out once it is in the state, if any: the rendezvous of the members of a
+ *  team with the referee at the barrier of their team slot, or of the referee with the two teams of its match,
+ *  followed at the end of the match by the release of their slots.
+ *
+ *  A state change of an entity is a single call of <tt>stateChange</tt>, which enters the critical region,
+ *  checks the transition against the table, stores the new state, saves it in the log, adds to the metrics
+ *  counter of the state, if any, leaves the critical region (writing the deferred log records) and carries out
+ *  the synchronization of the state, if any. When more has to be done in the critical region, the three steps
+ *  <tt>stateEnter</tt>, <tt>stateSet</tt> and <tt>stateLeave</tt> are called on their own. A failed semaphore or
+ *  barrier operation reports the entity type and ends the entity.
+ *
+ *  The wakeups of the team formation, whose counts depend on the formation word, stay in team.c.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef STATE_H_
+#define STATE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+#include "logging.h"
+#include "semaphore.h"
+#include "replay.h"
+#include "metrics.h"
+#include "barrier.h"
+#include "team.h"
+
+/* Entity types */
+
+/** \brief player */
+#define  STATE_PLAYER       0
+/** \brief goalie */
+#define  STATE_GOALIE       1
+/** \brief referee */
+#define  STATE_REFEREE      2
+/** \brief number of entity types */
+#define  STATE_TYPES        3
+
+/** \brief number of entries of the table of each type (the states are characters) */
+#define  STATE_CODES        128
+
+/** \brief no metrics counter for the entry in a state */
+#define  STATE_NO_METRIC    (-1)
+
+/* Synchronization of an entity once in a state */
+
+/** \brief none */
+#define  STATE_SYNC_NONE     0
+/** \brief rendezvous at the barrier of the team slot of the entity (a member of the team) */
+#define  STATE_SYNC_TEAM     1
+/** \brief rendezvous at the barriers of the NUMTEAMS team slots of the match (its referee) */
+#define  STATE_SYNC_MATCH    2
+/** \brief rendezvous at the barriers of the match, then release of its team slots (end of the match) */
+#define  STATE_SYNC_END      3
+
+/**
+ *  \brief Definition of <em>state</em> data type (an entry of the state table).
+ */
+typedef struct
+{   /** \brief name of the state (NULL if it is not a state of the entity type) */
+    const char *name;
+    /** \brief counter of the metrics block added to on entry (STATE_NO_METRIC if none) */
+    int metric;
+    /** \brief states from which the state may be entered (the initial state enters itself) */
+    const char *from;
+    /** \brief synchronization once in the state (STATE_SYNC_NONE, STATE_SYNC_TEAM, STATE_SYNC_MATCH or
+               STATE_SYNC_END) */
+    int sync;
+} STATE_DEF;
+
+/** \brief state table: the states of each entity type, indexed by their code */
+extern const STATE_DEF stateTable[STATE_TYPES][STATE_CODES];
+
+/** \brief short name of each entity type, used in the error messages */
+extern const char *const stateTag[STATE_TYPES];
+
+/**
+ *  \brief Name of a state of an entity type.
+ *
+ *  \param type STATE_PLAYER, STATE_GOALIE or STATE_REFEREE
+ *  \param state state
+ *
+ *  \return name ("?" if it is not a state of the type)
+ */
+extern const char *stateName (int type, unsigned int state);
+
+/**
+ *  \brief Type of an entity.
+ *
+ *  \param p_fSt pointer to the full state (number of entities of each type)
+ *  \param entity entity number
+ *
+ *  \return STATE_PLAYER, STATE_GOALIE or STATE_REFEREE
+ */
+static inline int stateType (FULL_STAT *p_fSt, int entity)
+{
+    return (entity < p_fSt->nPlayers) ? STATE_PLAYER
+                                      : (entity < p_fSt->nPlayers + p_fSt->nGoalies) ? STATE_GOALIE : STATE_REFEREE;
+}
+
+/**
+ *  \brief Report of a failed operation of an entity, which ends it.
+ *
+ *  \param sh pointer to the shared region
+ *  \param entity entity number
+ *  \param what operation
+ */
+static inline void stateFail (SHARED_DATA *sh, int entity, const char *what)
+{
+    char msg[80];
+
+    snprintf (msg, sizeof (msg), "error on %s (%s)", what, stateTag[stateType (&sh->fSt, entity)]);
+    perror (msg);
+    exit (EXIT_FAILURE);
+}
+
+/**
+ *  \brief Entry of an entity in the critical region (the entity ends on failure).
+ *
+ *  \param semgid semaphore set identifier
+ *  \param sh pointer to the shared region
+ *  \param entity entity number
+ */
+static inline void stateEnter (int semgid, SHARED_DATA *sh, int entity)
+{
+    if (regionEnter (semgid, sh, entity) == -1) {                                     /* enter critical region */
+        stateFail (sh, entity, "the down operation for semaphore access");
+    }
+}
+
+/**
+ *  \brief State change of an entity, inside the critical region.
+ *
+ *  The state is stored and saved in the log, and the metrics counter of the state, if any, is added to.
+ *
+ *  \param sh pointer to the shared region
+ *  \param nFic name of the logging file
+ *  \param entity entity number
+ *  \param state new state
+ */
+static inline void stateSet (SHARED_DATA *sh, char nFic[], int entity, unsigned int state)
+{
+    const STATE_DEF *def = &stateTable[stateType (&sh->fSt, entity)][state & (STATE_CODES - 1)];
+
+    assert ((def->name != NULL) && (sh->fSt.st[entity] != 0) &&      /* strchr would match the NUL of the list */
+            (strchr (def->from, sh->fSt.st[entity]) != NULL));                          /* a transition of the table */
+    sh->fSt.st[entity] = state;
+    saveState (nFic, &sh->fSt);
+    if (def->metric != STATE_NO_METRIC) {
+        metricsAdd (sh, def->metric, 1);
+    }
+}
+
+/**
+ *  \brief Exit of an entity from the critical region (the entity ends on failure).
+ *
+ *  The deferred log records are written after the mutex is released.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param sh pointer to the shared region
+ *  \param nFic name of the logging file
+ *  \param entity entity number
+ */
+static inline void stateLeave (int semgid, SHARED_DATA *sh, char nFic[], int entity)
+{
+    if (semUp (semgid, sh->mutex) == -1) {                                             /* exit critical region */
+        stateFail (sh, entity, "the up operation for semaphore access");
+    }
+    flushState (nFic);                                                              /* write deferred log records */
+}
+
+/**
+ *  \brief Synchronization of an entity once in a state, outside the critical region (the entity ends on failure).
+ *
+ *  The entity arrives at all the barriers before waiting on them, so the last party to arrive at each one wakes
+ *  up the whole team with a single broadcast and the members of other matches are never woken up.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param sh pointer to the shared region
+ *  \param entity entity number
+ *  \param sync synchronization of the state
+ *  \param slot team slot of a member, or the NUMTEAMS team slots of the match of a referee
+ */
+static inline void stateSync (int semgid, SHARED_DATA *sh, int entity, int sync, const int *slot)
+{
+    unsigned int phase[NUMTEAMS];
+    int n = (sync == STATE_SYNC_TEAM) ? 1 : NUMTEAMS, t;
+    uint64_t t0;
+
+    if (sync == STATE_SYNC_NONE) {
+        return;
+    }
+    t0 = metricsNow ();
+    for (t = 0; t < n; t++) {
+        if (barrierArrive (&TEAM_SLOT (sh, slot[t])->barrier, &phase[t]) == -1) {
+            stateFail (sh, entity, "the barrier of the match");
+        }
+    }
+    for (t = 0; t < n; t++) {
+        if (barrierWait (&TEAM_SLOT (sh, slot[t])->barrier, phase[t]) == -1) {
+            stateFail (sh, entity, "the barrier of the match");
+        }
+    }
+    metricsWait (t0);
+    if (sync == STATE_SYNC_END) {                                      /* the referee has collected the members */
+        teamRelease (semgid, sh, entity, slot, NUMTEAMS);
+    }
+}
+
+/**
+ *  \brief State change of an entity, in a critical region of its own, followed by the synchronization of the
+ *  new state.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param sh pointer to the shared region
+ *  \param nFic name of the logging file
+ *  \param entity entity number
+ *  \param state new state
+ *  \param slot team slot(s) of the synchronization of the state (NULL if it has none)
+ */
+static inline void stateChange (int semgid, SHARED_DATA *sh, char nFic[], int entity, unsigned int state,
+                                const int *slot)
+{
+    stateEnter (semgid, sh, entity);
+    stateSet (sh, nFic, entity, state);
+    stateLeave (semgid, sh, nFic, entity);
+    stateSync (semgid, sh, entity, stateTable[stateType (&sh->fSt, entity)][state & (STATE_CODES - 1)].sync, slot);
+}
+
+#endif /* STATE_H_ */
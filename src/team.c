@@ -0,0 +1,265 @@
+/**
+ *  \file team.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Lock-free team formation.
+ *
+ *  Implementation of the interface defined in team.h, shared by players and goalies.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "sharedDataSync.h"
+#include "semaphore.h"
+#include "replay.h"
+#include "team.h"
+#include "metrics.h"
+
+/** \brief wait before trying again: with TEAM_ORDERED the caller is in the critical region and leaves it meanwhile */
+static void teamRetry (int semgid, SHARED_DATA *sh, int member);
+
+/** \brief signal of the queued teams to the referees (and, for the last team of the game, of the end of the teams) */
+static void teamSignal (int semgid, SHARED_DATA *sh, int queued, bool last);
+
+int teamArrive (SHARED_DATA *sh, bool goalie, uint64_t *p_word)
+{
+    FULL_STAT *st = &sh->fSt;
+    int nT = goalie ? st->nTeamGoalies : st->nTeamPlayers;
+    uint64_t old, new;
+
+    old = __atomic_load_n (&st->formation, __ATOMIC_RELAXED);
+    do {
+        if (FORM_TEAMS (old) >= MAX_TEAMS (st))                         /* all the teams of the game are formed */
+           return TEAM_LATE;
+        if (!st->tournament &&                                          /* the two teams already have all their members */
+            (FORM_TEAMS (old) * nT + (goalie ? FORM_GOALIES (old) : FORM_PLAYERS (old)) >= MAX_TEAMS (st) * nT))
+           return TEAM_LATE;
+        new = old + (goalie ? FORM_GOALIE : FORM_PLAYER);
+        if ((FORM_PLAYERS (new) >= st->nTeamPlayers) && (FORM_GOALIES (new) >= st->nTeamGoalies))
+           new += FORM_TEAM - st->nTeamPlayers * FORM_PLAYER - st->nTeamGoalies * FORM_GOALIE;
+    } while (!__atomic_compare_exchange_n (&st->formation, &old, new, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    *p_word = new;
+    return (FORM_TEAMS (new) != FORM_TEAMS (old)) ? TEAM_FORM : TEAM_WAIT;
+}
+
+void teamForm (int semgid, SHARED_DATA *sh, bool goalie, int member, uint64_t word)
+{
+    FULL_STAT *st = &sh->fSt;
+    TEAM *team;
+    struct sembuf call[2];
+    unsigned int nOps = 0;
+    int nP = st->nTeamPlayers - !goalie, nG = st->nTeamGoalies - goalie, k, free_;
+
+    /* no more than nTeamSlots teams are formed and not yet ended: a slot is free, or is freed as soon as the
+       referee of an ended match has collected its members */
+    for (k = 0; ; k = (k + 1) % sh->nTeamSlots) {
+        team = TEAM_SLOT (sh, k);
+        free_ = 0;
+        if (__atomic_compare_exchange_n (&team->id, &free_, TEAM_CLAIMED, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+           break;
+        if (k == sh->nTeamSlots - 1)
+           teamRetry (semgid, sh, member);
+    }
+    team->referee = -1;
+    team->nMembers = 0;
+    __atomic_store_n (&team->id, FORM_TEAMS (word), __ATOMIC_RELEASE);    /* the members may now register */
+
+    if (FORM_TEAMS (word) == MAX_TEAMS (st)) {                          /* last team: the free entities are late */
+       nP += FORM_PLAYERS (word);
+       nG += FORM_GOALIES (word);
+    }
+    if (TEAM_ORDERED (sh)) {                                            /* the former is in the critical region */
+       st->playersCalled += nP;
+       st->goaliesCalled += nG;
+       return;
+    }
+    if (nG > 0)
+       call[nOps++] = (struct sembuf) { sh->goaliesWaitTeam, nG, 0 };
+    if (nP > 0)
+       call[nOps++] = (struct sembuf) { sh->playersWaitTeam, nP, 0 };
+    if ((nOps > 0) && (semOps (semgid, call, nOps) == -1)) {
+        perror ("error on the up operation for semaphore access (TM)");
+        exit (EXIT_FAILURE);
+    }
+}
+
+void teamWait (int semgid, SHARED_DATA *sh, bool goalie, int member)
+{
+    int *called = goalie ? &sh->fSt.goaliesCalled : &sh->fSt.playersCalled;
+    uint64_t t0 = metricsNow ();
+
+    if (!TEAM_ORDERED (sh)) {
+       if (semDown (semgid, goalie ? sh->goaliesWaitTeam : sh->playersWaitTeam) == -1) {
+           perror ("error on the down operation for semaphore access (TM)");
+           exit (EXIT_FAILURE);
+       }
+       metricsWait (t0);
+       return;
+    }
+
+    /* the semaphores would wake the free entities in an order of their own, not the order of entry */
+    if (regionEnter (semgid, sh, member) == -1) {                                                 /* enter critical region */
+        perror ("error on the down operation for semaphore access (TM)");
+        exit (EXIT_FAILURE);
+    }
+    while (*called == 0)
+      teamRetry (semgid, sh, member);
+    (*called)--;
+    metricsWait (t0);
+    if (semUp (semgid, sh->mutex) == -1) {                                                         /* exit critical region */
+        perror ("error on the up operation for semaphore access (TM)");
+        exit (EXIT_FAILURE);
+    }
+}
+
+int teamJoin (int semgid, SHARED_DATA *sh, bool goalie, int member, int *p_slot)
+{
+    FULL_STAT *st = &sh->fSt;
+    TEAM *team;
+    bool ordered = TEAM_ORDERED (sh), complete, last = false;
+    int nT = goalie ? st->nTeamGoalies : st->nTeamPlayers, t, id, k, queued = 0;
+
+    if (ordered && (regionEnter (semgid, sh, member) == -1)) {                                  /* enter critical region */
+        perror ("error on the down operation for semaphore access (TM)");
+        exit (EXIT_FAILURE);
+    }
+    t = __atomic_fetch_add (goalie ? &st->goalieTickets : &st->playerTickets, 1, __ATOMIC_RELAXED);
+    if ((id = t / nT + 1) > MAX_TEAMS (st)) {                           /* released as late by the last former */
+        if (ordered && (semUp (semgid, sh->mutex) == -1)) {                                      /* exit critical region */
+            perror ("error on the up operation for semaphore access (TM)");
+            exit (EXIT_FAILURE);
+        }
+        return 0;
+    }
+
+    /* the former of the team may not have published its slot yet */
+    for (k = 0; __atomic_load_n (&TEAM_SLOT (sh, k)->id, __ATOMIC_ACQUIRE) != id; k = (k + 1) % sh->nTeamSlots)
+      if (k == sh->nTeamSlots - 1)
+         teamRetry (semgid, sh, member);
+    team = TEAM_SLOT (sh, k);
+    team->member[goalie ? st->nTeamPlayers + t % nT : t % nT] = member;
+    *p_slot = k;
+    complete = (__atomic_add_fetch (&team->nMembers, 1, __ATOMIC_ACQ_REL) == st->nTeamPlayers + st->nTeamGoalies);
+
+    if (!ordered && complete && (regionEnter (semgid, sh, member) == -1)) {                     /* enter critical region */
+        perror ("error on the down operation for semaphore access (TM)");
+        exit (EXIT_FAILURE);
+    }
+    if (complete) {                                                     /* the last member completes the team */
+        TEAM_QUEUE (sh)[(id - 1) % sh->nTeamSlots] = k;                 /* the team waits for a referee, in id order */
+        while ((st->teamsQueued < sh->nTeamSlots) &&                   /* the teams up to the first one not complete */
+               (TEAM_QUEUE (sh)[(sh->queueHead + st->teamsQueued) % sh->nTeamSlots] != TEAM_NOT_QUEUED)) {
+          st->teamsQueued++;
+          queued++;
+        }
+        last = (++st->teamsComplete == MAX_TEAMS (st));
+        metricsAdd (sh, METRIC_TEAMS, 1);
+    }
+    if ((ordered || complete) && (semUp (semgid, sh->mutex) == -1)) {                            /* exit critical region */
+        perror ("error on the up operation for semaphore access (TM)");
+        exit (EXIT_FAILURE);
+    }
+    if (!ordered && complete)
+       teamSignal (semgid, sh, queued, last);
+    return id;
+}
+
+void teamRelease (int semgid, SHARED_DATA *sh, int entity, const int *slot, int n)
+{
+    int t;
+
+    if (TEAM_ORDERED (sh) && (regionEnter (semgid, sh, entity) == -1)) {                        /* enter critical region */
+        perror ("error on the down operation for semaphore access (TM)");
+        exit (EXIT_FAILURE);
+    }
+    for (t = 0; t < n; t++)
+      __atomic_store_n (&TEAM_SLOT (sh, slot[t])->id, 0, __ATOMIC_RELEASE);
+    if (TEAM_ORDERED (sh) && (semUp (semgid, sh->mutex) == -1)) {                                /* exit critical region */
+        perror ("error on the up operation for semaphore access (TM)");
+        exit (EXIT_FAILURE);
+    }
+}
+
+bool teamTake (int semgid, SHARED_DATA *sh, int referee, int entity, int *match)
+{
+    FULL_STAT *st = &sh->fSt;
+    bool ordered = TEAM_ORDERED (sh), ret = false;
+    uint64_t t0 = metricsNow ();
+    int t;
+
+    if (!ordered) {
+       if (semDownN (semgid, sh->refereeWaitTeams, NUMTEAMS) == -1) {
+           perror ("error on the down operation for semaphore access (TM)");
+           exit (EXIT_FAILURE);
+       }
+       metricsWait (t0);
+    }
+    if (regionEnter (semgid, sh, entity) == -1) {                                                 /* enter critical region */
+        perror ("error on the down operation for semaphore access (TM)");
+        exit (EXIT_FAILURE);
+    }
+    /* the semaphore would wake the referees in an order of its own, not the order of entry */
+    if (ordered) {
+       while ((st->teamsQueued < NUMTEAMS) && (st->teamsComplete < MAX_TEAMS (st)))
+         teamRetry (semgid, sh, entity);
+       metricsWait (t0);
+    }
+    if (st->teamsQueued >= NUMTEAMS) {                                  /* no teams queued: all matches are taken */
+       for (t = 0; t < NUMTEAMS; t++) {
+         match[t] = TEAM_QUEUE (sh)[sh->queueHead];
+         TEAM_QUEUE (sh)[sh->queueHead] = TEAM_NOT_QUEUED;
+         sh->queueHead = (sh->queueHead + 1) % sh->nTeamSlots;
+         TEAM_SLOT (sh, match[t])->referee = referee;
+       }
+       st->teamsQueued -= NUMTEAMS;
+       ret = true;
+    }
+    if (semUp (semgid, sh->mutex) == -1) {                                                         /* exit critical region */
+        perror ("error on the up operation for semaphore access (TM)");
+        exit (EXIT_FAILURE);
+    }
+    return ret;
+}
+
+static void teamRetry (int semgid, SHARED_DATA *sh, int member)
+{
+    if (!TEAM_ORDERED (sh)) {
+       sched_yield ();
+       return;
+    }
+    if (semUp (semgid, sh->mutex) == -1) {                                                         /* exit critical region */
+        perror ("error on the up operation for semaphore access (TM)");
+        exit (EXIT_FAILURE);
+    }
+    usleep (TEAM_POLL);
+    if (regionEnter (semgid, sh, member) == -1) {                                                 /* enter critical region */
+        perror ("error on the down operation for semaphore access (TM)");
+        exit (EXIT_FAILURE);
+    }
+}
+
+static void teamSignal (int semgid, SHARED_DATA *sh, int queued, bool last)
+{
+    if ((queued > 0) && (semUpN (semgid, sh->refereeWaitTeams, queued) == -1)) {
+        perror ("error on the up operation for semaphore access (TM)");
+        exit (EXIT_FAILURE);
+    }
+    if (sh->fSt.tournament && last && (semUpN (semgid, sh->refereeWaitTeams, NUMTEAMS * sh->fSt.nReferees) == -1)) {
+        perror ("error on the up operation for semaphore access (TM)");      /* the referees with no match left leave */
+        exit (EXIT_FAILURE);
+    }
+}
@@ -0,0 +1,151 @@
+/**
+ *  \file team.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Lock-free team formation.
+ *
+ *  Players and goalies form teams without holding the mutex across the handshake:
+ *     \li on arrival, an entity updates with a single compare and swap the <em>formation word</em>, where the
+ *         number of free players, the number of free goalies and the number of teams formed are packed; when the
+ *         entity completes a team it takes the team number and the free counters are decremented by a team, and
+ *         when the word leaves no place for it the entity is late. The arrival is done in the critical region
+ *         where the entity saves its new state, so the log follows the order of the arrivals and no entity is
+ *         logged late before the arrivals that took the last places
+ *     \li the entity that completes a team (the former) claims a free team slot by compare and swap and calls
+ *         the free teammates that wait for it on <tt>playersWaitTeam</tt> / <tt>goaliesWaitTeam</tt>
+ *     \li every member, the former included, takes a ticket (atomic counter per entity type): ticket
+ *         <tt>t</tt> joins team <tt>t / members of that type + 1</tt>, so the called teammates do not need to
+ *         know which former called them, and registers in the slot of that team
+ *     \li the last member to register completes the team: it is queued for a referee in the order of the team
+ *         ids, inside a short critical region, and the referees are signalled on <tt>refereeWaitTeams</tt> of
+ *         the complete teams at the head of the queue; a team completed before a team of a lower id waits for
+ *         it, so a referee always takes an odd team and the next even team, team 1 and team 2 of its match, as
+ *         the members take their side from the parity of the id
+ *     \li a referee takes two queued teams, the members of a match and its referee meet at the barrier of
+ *         their team slot (<tt>barrierArriveAndWait</tt>) at its start and at its end, and the slots are released
+ *         at the end of the match.
+ *
+ *  The former of the last team of the tournament also calls the entities that are still free, which take
+ *  tickets past the last team and are late.
+ *
+ *  When the order of entry in the critical region is recorded or replayed, the formation is done inside the
+ *  critical region (see TEAM_ORDERED).
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef TEAM_H_
+#define TEAM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "probConst.h"
+#include "sharedDataSync.h"
+
+/* Result of an arrival */
+
+/** \brief no team will be formed with the entity, it is late */
+#define  TEAM_LATE          0
+/** \brief the entity is free, it waits to be called by the former of a team */
+#define  TEAM_WAIT          1
+/** \brief the entity completed a team, it is its former */
+#define  TEAM_FORM          2
+
+/**
+ *  \brief The formation follows the order of the critical region (record and replay of that order).
+ *
+ *  The call of the free teammates, their wait for it and the registration in a team (ticket, slot and
+ *  completion of the team), which decide the team with the arrival, are then done inside the critical region
+ *  too, so that the recorded order of entry also reproduces the teams.
+ */
+#define  TEAM_ORDERED(sh)   ((sh)->replay.mode != REPLAY_OFF)
+
+/**
+ *  \brief Arrival of a player or goalie, inside the critical region where its new state is saved.
+ *
+ *  Outside tournament mode an entity is also late when the two teams already have places for all the entities
+ *  of its type.
+ *
+ *  \param sh pointer to the shared region
+ *  \param goalie true for a goalie, false for a player
+ *  \param p_word pointer to the location where the formation word set by the arrival is stored
+ *
+ *  \return TEAM_LATE, TEAM_WAIT or TEAM_FORM
+ */
+extern int teamArrive (SHARED_DATA *sh, bool goalie, uint64_t *p_word);
+
+/**
+ *  \brief Formation of a team by its former: claim of a free team slot and call of the free teammates.
+ *
+ *  With TEAM_ORDERED, the former is called inside the critical region and the calls are counted in the shared
+ *  region instead of being semaphore ups.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param sh pointer to the shared region
+ *  \param goalie true if the former is a goalie
+ *  \param member member number of the former (index in the entity states)
+ *  \param word formation word set by the arrival of the former
+ */
+extern void teamForm (int semgid, SHARED_DATA *sh, bool goalie, int member, uint64_t word);
+
+/**
+ *  \brief Wait of a free player or goalie for the call of the former of a team.
+ *
+ *  With TEAM_ORDERED, the entity takes a call counted by teamForm, checking every TEAM_POLL us inside the
+ *  critical region, so that the recorded order of entry also decides which entities are called. The critical
+ *  region is never held while waiting for a free or a published team slot either.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param sh pointer to the shared region
+ *  \param goalie true for a goalie, false for a player
+ *  \param member member number (index in the entity states)
+ */
+extern void teamWait (int semgid, SHARED_DATA *sh, bool goalie, int member);
+
+/**
+ *  \brief Registration of a player or goalie in the team of its ticket.
+ *
+ *  The last member to register completes the team and queues it in the order of the team ids.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param sh pointer to the shared region
+ *  \param goalie true for a goalie, false for a player
+ *  \param member member number (index in the entity states)
+ *  \param p_slot pointer to the location where the team slot is stored
+ *
+ *  \return id of the team (0 if the ticket is past the last team: the entity is late)
+ */
+extern int teamJoin (int semgid, SHARED_DATA *sh, bool goalie, int member, int *p_slot);
+
+/**
+ *  \brief Wait of a referee for two queued teams and their removal from the queue.
+ *
+ *  With TEAM_ORDERED, the referee checks the queue every TEAM_POLL us inside the critical region, so that the
+ *  recorded order of entry also decides which referee takes the teams.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param sh pointer to the shared region
+ *  \param referee referee id
+ *  \param entity entity number of the referee (index in the entity states)
+ *  \param match pointer to the location where the NUMTEAMS team slots of the match are stored
+ *
+ *  \return true if the referee has a match to referee (false when all the teams were already taken)
+ */
+extern bool teamTake (int semgid, SHARED_DATA *sh, int referee, int entity, int *match);
+
+/**
+ *  \brief Release of the team slots of an ended match, once the referee has collected their members.
+ *
+ *  With TEAM_ORDERED, the slots are released inside the critical region.
+ *
+ *  \param semgid semaphore set identifier
+ *  \param sh pointer to the shared region
+ *  \param entity entity number of the referee (index in the entity states)
+ *  \param slot team slots
+ *  \param n number of team slots
+ */
+extern void teamRelease (int semgid, SHARED_DATA *sh, int entity, const int *slot, int n);
+
+#endif /* TEAM_H_ */
@@ -0,0 +1,249 @@
+/**
+ *  \file trace.c (implementation file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Event tracing in the Chrome / Perfetto trace format.
+ *
+ *  Implementation of the interface defined in trace.h. A part file is the array of the binary events of the
+ *  entity, in time order (the processes of the entity in successive games append to it); the merge turns the
+ *  state transitions into complete events (<tt>"ph":"X"</tt>, from a transition to the next one of the same
+ *  entity) and the operations into begin / end event pairs (<tt>"ph":"B"</tt> / <tt>"ph":"E"</tt>), with times
+ *  in us since the first event of the game.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "probConst.h"
+#include "probDataStruct.h"
+#include "trace.h"
+#include "state.h"
+
+/** \brief number of events of the buffer of an entity */
+#define  TRACE_BUF          8192
+
+/** \brief number of events read at a time by the merge */
+#define  TRACE_BLOCK        4096
+
+/** \brief process id of the tracks in the trace (all the entities are tracks of one game) */
+#define  TRACE_PID          1
+
+/**
+ *  \brief Definition of <em>trace event</em> data type (part files).
+ */
+typedef struct
+{   /** \brief time of the event (ns, CLOCK_MONOTONIC) */
+    uint64_t ts;
+    /** \brief semaphore location, or new state of the entity */
+    uint32_t arg;
+    /** \brief kind of event (TRACE_STATE .. TRACE_BARRIER) */
+    uint16_t kind;
+    /** \brief phase: 'B' (begin), 'E' (end) or 'i' (state transition) */
+    uint16_t ph;
+} TRACE_EVENT;
+
+/** \brief events of the entity not yet written (NULL if the entity is not traced) */
+static ENTITY_LOCAL TRACE_EVENT *buf = NULL;
+
+/** \brief number of events in the buffer */
+static ENTITY_LOCAL int nBuf;
+
+/** \brief entity number of the traced entity */
+static ENTITY_LOCAL int traced;
+
+/** \brief name of the part file of the entity */
+static ENTITY_LOCAL char part[TRACE_NAME_LEN + 16];
+
+static void partName (char *dst, size_t size, const char *name, int entity)
+{
+    snprintf (dst, size, "%s.%d", name, entity);
+}
+
+/** \brief append the buffer to the part file */
+static void flush (void)
+{
+    int fd;
+
+    if (nBuf == 0) {
+        return;
+    }
+    if (((fd = open (part, O_WRONLY | O_CREAT | O_APPEND, 0600)) == -1) ||
+        (write (fd, buf, nBuf * sizeof (TRACE_EVENT)) != (ssize_t) (nBuf * sizeof (TRACE_EVENT)))) {
+        perror ("error on writing the trace events (the trace is incomplete)");
+    }
+    if (fd != -1) {
+        close (fd);
+    }
+    nBuf = 0;
+}
+
+static void record (int kind, int ph, unsigned int arg)
+{
+    struct timespec t;
+    int err = errno;                                          /* the traced operation may have reported an error */
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    buf[nBuf].ts = (uint64_t) t.tv_sec * 1000000000ull + t.tv_nsec;
+    buf[nBuf].arg = arg;
+    buf[nBuf].kind = (uint16_t) kind;
+    buf[nBuf].ph = (uint16_t) ph;
+    if (++nBuf == TRACE_BUF) {
+        flush ();
+    }
+    errno = err;
+}
+
+void traceOpen (const char *name, int entity)
+{
+    if ((name[0] == '\0') || ((buf = malloc (TRACE_BUF * sizeof (TRACE_EVENT))) == NULL)) {
+        return;
+    }
+    nBuf = 0;
+    traced = entity;
+    partName (part, sizeof (part), name, entity);
+}
+
+void traceBegin (int kind, unsigned int arg)
+{
+    if (buf != NULL) {
+        record (kind, 'B', arg);
+    }
+}
+
+void traceEnd (int kind, unsigned int arg)
+{
+    if (buf != NULL) {
+        record (kind, 'E', arg);
+    }
+}
+
+void traceState (FULL_STAT *p_fSt)
+{
+    if (buf != NULL) {
+        record (TRACE_STATE, 'i', p_fSt->st[traced]);
+    }
+}
+
+void traceClose (void)
+{
+    if (buf != NULL) {
+        flush ();
+        free (buf);
+        buf = NULL;
+    }
+}
+
+void traceDiscard (const char *name, int nEntities)
+{
+    char file[TRACE_NAME_LEN + 16];
+    int e;
+
+    for (e = 0; e < nEntities; e++) {
+        partName (file, sizeof (file), name, e);
+        unlink (file);
+    }
+}
+
+/** \brief write the events of an entity, from its part file */
+static void mergeEntity (FILE *out, FILE *in, int tid, int type, uint64_t t0, const char *semName[],
+                         unsigned int nNames)
+{
+    static const char *kindName[] = { "state", "down", "up", "ops", "barrier" };
+    TRACE_EVENT ev[TRACE_BLOCK];
+    uint64_t stateTs = 0, lastTs = 0;
+    unsigned int state = 0;
+    bool inState = false;
+    size_t n, i;
+
+    while ((n = fread (ev, sizeof (TRACE_EVENT), TRACE_BLOCK, in)) > 0) {
+        for (i = 0; i < n; i++) {
+            lastTs = ev[i].ts;
+            if (ev[i].kind == TRACE_STATE) {
+                if (inState) {
+                    fprintf (out, ",\n{\"ph\":\"X\",\"cat\":\"state\",\"name\":\"%s\",\"pid\":%d,\"tid\":%d,"
+                             "\"ts\":%.3f,\"dur\":%.3f}", stateName (type, state), TRACE_PID, tid,
+                             (stateTs - t0) / 1e3, (ev[i].ts - stateTs) / 1e3);
+                }
+                inState = true;
+                state = ev[i].arg;
+                stateTs = ev[i].ts;
+            }
+            else if (ev[i].kind == TRACE_BARRIER) {
+                fprintf (out, ",\n{\"ph\":\"%c\",\"cat\":\"sync\",\"name\":\"barrier\",\"pid\":%d,\"tid\":%d,"
+                         "\"ts\":%.3f}", ev[i].ph, TRACE_PID, tid, (ev[i].ts - t0) / 1e3);
+            }
+            else if ((ev[i].arg < nNames) && (semName[ev[i].arg] != NULL)) {
+                fprintf (out, ",\n{\"ph\":\"%c\",\"cat\":\"sync\",\"name\":\"%s %s\",\"pid\":%d,\"tid\":%d,"
+                         "\"ts\":%.3f}", ev[i].ph, kindName[ev[i].kind], semName[ev[i].arg], TRACE_PID, tid,
+                         (ev[i].ts - t0) / 1e3);
+            }
+            else {
+                fprintf (out, ",\n{\"ph\":\"%c\",\"cat\":\"sync\",\"name\":\"%s %u\",\"pid\":%d,\"tid\":%d,"
+                         "\"ts\":%.3f}", ev[i].ph, kindName[ev[i].kind], ev[i].arg, TRACE_PID, tid,
+                         (ev[i].ts - t0) / 1e3);
+            }
+        }
+    }
+    if (inState) {                                                   /* the last state lasts until the last event */
+        fprintf (out, ",\n{\"ph\":\"X\",\"cat\":\"state\",\"name\":\"%s\",\"pid\":%d,\"tid\":%d,"
+                 "\"ts\":%.3f,\"dur\":%.3f}", stateName (type, state), TRACE_PID, tid,
+                 (stateTs - t0) / 1e3, (lastTs - stateTs) / 1e3);
+    }
+}
+
+int traceMerge (const char *name, FULL_STAT *p_fSt, const char *semName[], unsigned int nNames)
+{
+    int nP = p_fSt->nPlayers, nG = p_fSt->nGoalies, nEnt = nP + nG + p_fSt->nReferees, e;
+    char file[TRACE_NAME_LEN + 16], label[16];
+    uint64_t t0 = UINT64_MAX;
+    TRACE_EVENT first;
+    FILE *out, *in;
+
+    for (e = 0; e < nEnt; e++) {                                     /* times are relative to the first event */
+        partName (file, sizeof (file), name, e);
+        if ((in = fopen (file, "rb")) != NULL) {
+            if ((fread (&first, sizeof (first), 1, in) == 1) && (first.ts < t0)) {
+                t0 = first.ts;
+            }
+            fclose (in);
+        }
+    }
+
+    if ((out = fopen (name, "w")) == NULL) {
+        return -1;
+    }
+    fprintf (out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+             "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"SoccerGame\"}}",
+             TRACE_PID);
+    for (e = 0; e < nEnt; e++) {
+        if (e < nP) snprintf (label, sizeof (label), "P%02d", e);
+        else if (e < nP + nG) snprintf (label, sizeof (label), "G%02d", e - nP);
+        else snprintf (label, sizeof (label), "R%02d", e - nP - nG + 1);
+        fprintf (out, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}"
+                      ",\n{\"ph\":\"M\",\"name\":\"thread_sort_index\",\"pid\":%d,\"tid\":%d,"
+                      "\"args\":{\"sort_index\":%d}}", TRACE_PID, e + 1, label, TRACE_PID, e + 1, e);
+
+        partName (file, sizeof (file), name, e);
+        if ((in = fopen (file, "rb")) != NULL) {
+            mergeEntity (out, in, e + 1, stateType (p_fSt, e), t0, semName, nNames);
+            fclose (in);
+            unlink (file);
+        }
+    }
+    fprintf (out, "\n]}\n");
+    if (ferror (out)) {
+        fclose (out);
+        errno = EIO;
+        return -1;
+    }
+    return fclose (out);
+}
@@ -0,0 +1,96 @@
+/**
+ *  \file trace.h (interface file)
+ *
+ *  \brief Problem name: SoccerGame
+ *
+ *  \brief Event tracing in the Chrome / Perfetto trace format.
+ *
+ *  When a game is traced (<tt>--trace file</tt>), every entity keeps a buffer of timestamped events in its own
+ *  memory: its state transitions (saved by <tt>saveState</tt>) and the begin and end of its semaphore
+ *  operations and barrier waits. The buffer is appended to a part file of the entity (<tt>file.entity</tt>) when
+ *  full and when the entity ends; no lock is taken and nothing is shared. At the end, the main program merges the
+ *  part files into a single JSON trace (<tt>traceEvents</tt> array), with one track per player, goalie and referee,
+ *  that can be opened in Perfetto (ui.perfetto.dev) or <tt>chrome://tracing</tt>.
+ *
+ *  \author Nuno Lau - December 2024
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "probDataStruct.h"
+
+/* Kind of event */
+
+/** \brief state transition of the entity */
+#define  TRACE_STATE        0
+/** \brief <em>down</em> of a semaphore (by one or more units) */
+#define  TRACE_DOWN         1
+/** \brief <em>up</em> of a semaphore (by one or more units) */
+#define  TRACE_UP           2
+/** \brief array of operations on semaphores (the first semaphore of the array) */
+#define  TRACE_OPS          3
+/** \brief wait at a barrier */
+#define  TRACE_BARRIER      4
+
+/** \brief operation <tt>op</tt> (an int expression) traced as an event of kind <tt>kind</tt> on location <tt>arg</tt> */
+#define  TRACED(kind,arg,op)   ({ int ret_; traceBegin ((kind), (arg)); ret_ = (op); traceEnd ((kind), (arg)); ret_; })
+
+/**
+ *  \brief Start of the tracing of the entity.
+ *
+ *  \param name name of the trace file (nothing is traced if empty)
+ *  \param entity entity number (index in the entity states)
+ */
+extern void traceOpen (const char *name, int entity);
+
+/**
+ *  \brief Begin of an operation of the entity (nothing is done if it is not traced).
+ *
+ *  \param kind TRACE_DOWN, TRACE_UP, TRACE_OPS or TRACE_BARRIER
+ *  \param arg semaphore location (0 for a barrier)
+ */
+extern void traceBegin (int kind, unsigned int arg);
+
+/**
+ *  \brief End of an operation of the entity (nothing is done if it is not traced).
+ *
+ *  \param kind TRACE_DOWN, TRACE_UP, TRACE_OPS or TRACE_BARRIER
+ *  \param arg semaphore location (0 for a barrier)
+ */
+extern void traceEnd (int kind, unsigned int arg);
+
+/**
+ *  \brief State transition of the entity: its state in the full state (nothing is done if it is not traced).
+ *
+ *  \param p_fSt pointer to the location where the full internal state of the problem is stored
+ */
+extern void traceState (FULL_STAT *p_fSt);
+
+/**
+ *  \brief End of the tracing of the entity: the buffer is written to its part file and released.
+ */
+extern void traceClose (void);
+
+/**
+ *  \brief Removal of the part files left by a previous traced game.
+ *
+ *  \param name name of the trace file
+ *  \param nEntities number of entities
+ */
+extern void traceDiscard (const char *name, int nEntities);
+
+/**
+ *  \brief Merge of the part files of the entities into the JSON trace (the part files are removed).
+ *
+ *  \param name name of the trace file
+ *  \param p_fSt pointer to the full state (number of entities of each type)
+ *  \param semName names of the semaphore locations (NULL entries, or locations beyond nNames, are numbered)
+ *  \param nNames number of entries of semName
+ *
+ *  \return \c 0, upon success
+ *  \return -\c 1, when an error occurs (the actual situation is reported in <tt>errno</tt>)
+ */
+extern int traceMerge (const char *name, FULL_STAT *p_fSt, const char *semName[], unsigned int nNames);
+
+#endif /* TRACE_H_ */